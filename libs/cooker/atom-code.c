@@ -38,7 +38,8 @@ atom_code_t *atom_code_new (void)
 
 void atom_code_done (atom_code_t *acode)
 {
-    atom_done (&acode->atom);
+    // Nothing to free yet (and atom_done() would call us back)
+    (void)acode;
 }
 
 void atom_code_free (atom_code_t *acode)
@@ -21,7 +21,7 @@ bool atom_text_init (atom_text_t *atext, str_t *text)
 {
     atom_init (&atext->atom, ATOM_TEXT);
     atext->atom.vmt = &atom_text_vmt;
-    return str_set (&atext->text, text);
+    return sstr_init_str (&atext->text, text);
 }
 
 atom_text_t *atom_text_new (str_t *text)
@@ -38,8 +38,7 @@ atom_text_t *atom_text_new (str_t *text)
 
 void atom_text_done (atom_text_t *atext)
 {
-    atom_done (&atext->atom);
-    str_done (&atext->text);
+    sstr_done (&atext->text);
 }
 
 void atom_text_free (atom_text_t *atext)
@@ -51,5 +50,5 @@ void atom_text_free (atom_text_t *atext)
 void atom_text_text (atom_t *atom, str_t *str)
 {
     atom_text_t *atext = (atom_text_t *)atom;
-    str_set (str, &atext->text);
+    sstr_str (&atext->text, str);
 }
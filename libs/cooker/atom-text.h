@@ -9,6 +9,7 @@
 #define __atom_text_H__
 
 #include "atom.h"
+#include "sstr.h"
 
 /**
  * A text atom contains a single piece of text.
@@ -17,8 +18,8 @@ typedef struct
 {
     /// Parent class
     atom_t atom;
-    /// The text of the atom
-    str_t text;
+    /// The text of the atom (most words are short, so keep them inline)
+    sstr_t text;
 } atom_text_t;
 
 /**
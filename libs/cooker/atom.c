@@ -6,6 +6,7 @@
  */
 
 #include "var.h"
+#include "strbuild.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -17,6 +18,7 @@ void atom_init (atom_t *atom, atom_type_t type)
 
     memset (atom, 0, sizeof (*atom));
 
+    atomic_init (&atom->refcnt, 1);
     atom->type = type;
 }
 
@@ -68,7 +70,7 @@ static vector_vmt_t vector_atom_vmt =
 
 static void vector_atom_free (void *item)
 {
-    atom_free (item);
+    atom_unref (item);
 }
 
 void vector_atom_init (vector_t *vecw)
@@ -76,3 +78,81 @@ void vector_atom_init (vector_t *vecw)
     vector_init (vecw, 0);
     vecw->vmt = &vector_atom_vmt;
 }
+
+/* Append the text of a atom to a string builder,
+ * followed by a space unless this is the last atom or it is adjoined.
+ */
+static bool atom_text_append (str_builder_t *sb, atom_t *atom, bool last)
+{
+    str_t text;
+    atom->vmt->text (atom, &text);
+    bool ok = str_builder_append (sb, &text);
+    str_done (&text);
+
+    if (ok && !atom->adjoin && !last)
+        ok = str_builder_append_char (sb, ' ');
+
+    return ok;
+}
+
+static bool atom_text_flatten (str_builder_t *sb, bool ok, str_t *str)
+{
+    if (ok && str_builder_flatten (sb, str))
+        return true;
+
+    str_builder_done (sb);
+    return false;
+}
+
+bool vector_atom_text (vector_atom_t *veca, str_t *str)
+{
+    str_builder_t sb;
+    str_builder_init (&sb);
+
+    bool ok = true;
+    for (int i = 0; ok && (i < veca->size); i++)
+        ok = atom_text_append (&sb, veca->data [i], i + 1 >= veca->size);
+
+    return atom_text_flatten (&sb, ok, str);
+}
+
+// ---------- // ---------- // ---------- // ---------- // ---------- //
+
+static void pvector_atom_retain (void *item)
+{
+    atom_ref (item);
+}
+
+static void pvector_atom_release (void *item)
+{
+    atom_unref (item);
+}
+
+static const pvector_vmt_t pvector_atom_vmt =
+{
+    pvector_atom_retain,
+    pvector_atom_release,
+};
+
+void pvector_atom_init (pvector_t *vec)
+{
+    pvector_init (vec, &pvector_atom_vmt);
+}
+
+bool pvector_atom_text (const pvector_t *vec, str_t *str)
+{
+    str_builder_t sb;
+    str_builder_init (&sb);
+
+    bool ok = true;
+    for (int pos = 0; ok && (pos < vec->size); )
+    {
+        void **items;
+        int count = pvector_chunk (vec, pos, &items);
+        for (int i = 0; ok && (i < count); i++)
+            ok = atom_text_append (&sb, items [i], pos + i + 1 >= vec->size);
+        pos += count;
+    }
+
+    return atom_text_flatten (&sb, ok, str);
+}
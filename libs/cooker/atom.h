@@ -10,6 +10,9 @@
 
 #include "str.h"
 #include "vector.h"
+#include "pvector.h"
+
+#include <stdatomic.h>
 
 /// Atom types
 typedef enum
@@ -28,19 +31,25 @@ typedef struct
     /// Free memory associated with this object
     void (*done) (atom_t *atom);
 
-    /// Convert this atom to its text equivalent
+    /// Convert this atom to its text equivalent (free str with str_done())
     void (*text) (atom_t *atom, str_t *str);
 } atom_vmt_t;
 
 /**
  * The basic object which is part of Cook list values.
  * This is an abstract class.
+ *
+ * Atoms are immutable once created, so they are shared between
+ * lists with reference counting (see atom_ref() and atom_unref()).
  */
 typedef struct _atom_t
 {
     /// Virtual method table
     const atom_vmt_t *vmt;
 
+    /// Number of owners of this atom
+    atomic_int refcnt;
+
     /// Atom type
     atom_type_t type : 1;
 
@@ -86,6 +95,30 @@ extern void atom_done (atom_t *atom);
  */
 extern void atom_free (atom_t *atom);
 
+/**
+ * Add a reference to the atom.
+ *
+ * @param atom The atom which gets one more owner.
+ * @return The atom.
+ */
+static inline atom_t *atom_ref (atom_t *atom)
+{
+    atomic_fetch_add_explicit (&atom->refcnt, 1, memory_order_relaxed);
+    return atom;
+}
+
+/**
+ * Drop a reference to the atom. The atom is freed
+ * when the last reference is gone.
+ *
+ * @param atom The atom to unreference.
+ */
+static inline void atom_unref (atom_t *atom)
+{
+    if (atomic_fetch_sub_explicit (&atom->refcnt, 1, memory_order_acq_rel) == 1)
+        atom_free (atom);
+}
+
 // ---------- // ---------- // ---------- // ---------- // ---------- //
 
 /// A vector of atom_t's
@@ -93,11 +126,42 @@ typedef vector_t vector_atom_t;
 
 /**
  * Initialize a vector of atom_t objects. Vector elements
- * will automatically destroy when removed from the vector.
+ * are unreferenced when removed from the vector.
  * The vector is not sortable as there's no compare criteria.
  *
  * @param veca The vector to initialize.
  */
 extern void vector_atom_init (vector_atom_t *veca);
 
+/**
+ * Convert a list of atoms to text. Atoms are separated by spaces,
+ * except when the atom has to be adjoined with the next one.
+ *
+ * @param veca The vector of atoms.
+ * @param str The string to initialize with the result.
+ * @return false on memory allocation failure.
+ */
+extern bool vector_atom_text (vector_atom_t *veca, str_t *str);
+
+// ---------- // ---------- // ---------- // ---------- // ---------- //
+
+/**
+ * Initialize a persistent vector of atoms, which is the type of
+ * variable values. Atoms are shared between vectors with atom_ref(),
+ * so copying values and passing them to child contexts is O(1).
+ *
+ * @param vec The vector to initialize.
+ */
+extern void pvector_atom_init (pvector_t *vec);
+
+/**
+ * Convert a persistent vector of atoms to text, same way as
+ * vector_atom_text() does.
+ *
+ * @param vec The vector of atoms.
+ * @param str The string to initialize with the result.
+ * @return false on memory allocation failure.
+ */
+extern bool pvector_atom_text (const pvector_t *vec, str_t *str);
+
 #endif /* __atom_H */
@@ -8,7 +8,19 @@
 #include <string.h>
 
 #define YYLTYPE parser_pos_t
-#define YYLTYPE_IS_TRIVIAL 1
+
+/* The location of a rule spans from its first to its last symbol */
+#define YYLLOC_DEFAULT(Current, Rhs, N) \
+    do \
+        if (N) \
+        { \
+            (Current).first_ofs = YYRHSLOC (Rhs, 1).first_ofs; \
+            (Current).last_ofs = YYRHSLOC (Rhs, N).last_ofs; \
+        } \
+        else \
+            (Current).first_ofs = (Current).last_ofs = \
+                YYRHSLOC (Rhs, 0).last_ofs; \
+    while (0)
 
 %}
 
@@ -22,12 +34,10 @@
 
 %union
 {
-    /* terminal symbol value */
-    token_t token;
+    /* terminal symbol value: the index of token in parser->tokens */
+    int token;
 }
 
-%destructor { token_done (&$$); } <token>
-
 %token <token> SPACE
 %token <token> NEXT
 %token <token> WORD
@@ -41,20 +51,33 @@
 %token <token> BRACE_CLOSE
 %token <token> COMMA
 
+/* The index of the WORD token if the value is a single plain word, or -1 */
+%type <token> value
+%type <token> adjoined-value
+
 %{
 
 int yylex (YYSTYPE *sym, YYLTYPE *loc, parser_t *parser);
 void yyerror (YYLTYPE *loc, parser_t *parser, const char *msg);
 
+/* A word used as a name is interned (see token_buf_sym()) as soon as
+   it is parsed, so names are then compared just by pointer. Escaped
+   words are not interned, for them NULL is not an error. */
+#define PARSER_NAME(idx) \
+    if (!token_buf_sym (&parser->tokens, &parser->input, idx) && \
+        !(parser->tokens.flags [idx] & TOKEN_BUF_ESCAPED)) \
+        YYNOMEM
+
 %}
 
 %%
 
+/* Left recursion keeps the parser stack flat on long scripts */
 statements:
     %empty
-  | assignment statements
-  | implicit-unveil statements
-  | error NEXT statements
+  | statements assignment
+  | statements implicit-unveil
+  | statements error NEXT
 ;
 
 assignment:
@@ -66,7 +89,7 @@ implicit-unveil:
 ;
 
 identifier:
-    adjoined-value
+    adjoined-value                      { if ($1 >= 0) PARSER_NAME ($1); }
 ;
 
 identifier-list:
@@ -94,18 +117,18 @@ list:
 ;
 
 adjoined-value:
-    value
-  | value adjoined-value
+    value                               { $$ = $1; }
+  | value adjoined-value                { $$ = -1; }
 ;
 
 value:
-    WORD
-  | BRACE_OPEN statements BRACE_CLOSE
-  | explicit-unveil
+    WORD                                { $$ = $1; }
+  | BRACE_OPEN statements BRACE_CLOSE   { $$ = -1; }
+  | explicit-unveil                     { $$ = -1; }
 ;
 
 explicit-unveil:
-    SIMPLE_UNVEIL WORD
+    SIMPLE_UNVEIL WORD                  { PARSER_NAME ($2); }
   | SIMPLE_UNVEIL explicit-unveil
   | UNVEIL opt-space identifier SPACE args BRACE_CLOSE
 ;
@@ -119,27 +142,26 @@ args:
 
 int yylex (YYSTYPE *sym, YYLTYPE *loc, parser_t *parser)
 {
-next:
-    loc->first_line = parser->input.line;
-    loc->first_column = parser->input.column;
-
-    bool ok = input_token (&parser->input, &sym->token);
+    const token_buf_t *tokens = &parser->tokens;
 
-    loc->last_line = parser->input.line;
-    loc->last_column = parser->input.column;
-
-    if (!ok)
+next:
+    if (parser->token_idx >= tokens->size)
     {
-        /* Parser error, display error and return %empty */
-        return YYEMPTY;
+        /* End of input */
+        loc->first_ofs = loc->last_ofs = parser->input.text.size;
+        return YYEOF;
     }
 
+    int idx = parser->token_idx++;
+    sym->token = idx;
+    loc->first_ofs = tokens->ofs [idx];
+    loc->last_ofs = loc->first_ofs + tokens->len [idx];
+
     /* Take action depending on token type */
-    switch (sym->token.code)
+    switch ((token_code_t)tokens->code [idx])
     {
 #define LT(t)   case TOK_##t: return t;
         LT (SPACE)
-        LT (NEXT)
         LT (WORD)
         LT (ASSIGN)
         LT (APPEND)
@@ -152,11 +174,26 @@ next:
         LT (COMMA)
 #undef LT
 
+        case TOK_NEXT:
+        {
+            /* Every line break was lexed as NEXT, since the statement
+               indents were not known yet (see token_buf_fill()) */
+            str_t spaces;
+            str_init_c_const (&spaces, parser->input.text.data + loc->first_ofs,
+                              tokens->len [idx]);
+            parser->input.indent = input_indent (&spaces);
+
+            if (parser->input.indent <= parser->input.stmt_indent)
+                return NEXT;
+            return SPACE;
+        }
+
         case TOK_ERROR:
-            // lexer error, display error and return %empty
+            /* lexer error, display it and let the parser recover */
+            parser->errors++;
             if (parser->error)
-                parser->error (parser, loc, YY_(""));
-            return YYEMPTY;
+                parser->error (parser, loc, YY_("invalid token"));
+            return YYerror;
 
         case TOK_COMMENT:
             // Silently ignore comments
@@ -169,6 +206,7 @@ next:
 
 void yyerror (YYLTYPE *loc, parser_t *parser, const char *msg)
 {
+    parser->errors++;
     if (parser->error)
-        parser->error ();
+        parser->error (parser, loc, msg);
 }
@@ -9,6 +9,8 @@
 
 #include <string.h>
 #include <limits.h>
+#include <errno.h>
+#include <unistd.h>
 
 void input_init (input_t *input)
 {
@@ -16,31 +18,231 @@ void input_init (input_t *input)
     str_init (&input->text);
     str_init (&input->name);
     input->stmt_indent = INT_MAX;
-    vector_init (&input->stmt_indent_vec, 0);
+    vector_indent_init (&input->stmt_indent_vec);
+    vector_ofs_init (&input->lines);
+    input->fd = -1;
+    input->eof = true;
 }
 
 void input_done (input_t *input)
 {
     str_done (&input->text);
     str_done (&input->name);
+    vector_indent_done (&input->stmt_indent_vec);
+    vector_ofs_done (&input->lines);
+}
+
+/* Rewind the input to the beginning of the text.
+ */
+static void input_rewind (input_t *input)
+{
+    input->ofs = 0;
+    input->indent = 0;
+    input->stmt_indent = INT_MAX;
+    vector_indent_clear (&input->stmt_indent_vec);
+    vector_ofs_clear (&input->lines);
+    input->lines_ofs = 0;
+    input->fd = -1;
+    input->eof = true;
+    input->read_error = false;
+    input->base = input->base_line = input->base_column = 0;
 }
 
 void input_set_text (input_t *input, str_t *text, str_t *name)
 {
-    memset (&input, 0, sizeof (input));
+    input_rewind (input);
 
     str_set (&input->text, text);
     str_set (&input->name, name);
 }
 
+bool input_set_file (input_t *input, const char *filename)
+{
+    str_t text;
+    if (!str_init_file (&text, filename))
+        return false;
+
+    str_done (&input->text);
+    input->text = text;
+    input_rewind (input);
+
+    str_done (&input->name);
+    return str_init_c_copy (&input->name, filename, -1);
+}
+
+bool input_set_fd (input_t *input, int fd, str_t *name, int chunk)
+{
+    input_rewind (input);
+
+    str_done (&input->text);
+    str_init (&input->text);
+    str_set (&input->name, name);
+
+    input->fd = fd;
+    input->chunk = (chunk > 0) ? chunk : INPUT_CHUNK;
+    input->eof = false;
+
+    return str_expand (&input->text, input->chunk);
+}
+
+// Count the columns taken by text without newlines, starting at column col
+static int input_columns (const char *data, int size, int col)
+{
+    for (int i = 0; i < size; i++)
+        switch (data [i])
+        {
+            case '\t':
+                col = (col + INPUT_TAB_SPACES) & ~(INPUT_TAB_SPACES - 1);
+                break;
+
+            case '\r':
+                break;
+
+            default:
+                col++;
+                break;
+        }
+
+    return col;
+}
+
+/* Drop the first size bytes of text, keeping track of the line
+ * and column where the text starts.
+ */
+static void input_drop (input_t *input, int size)
+{
+    const char *data = input->text.data;
+    const char *line_start = NULL;
+    for (const char *lf = data; (lf = memchr (lf, '\n', (size_t)(data + size - lf))); )
+    {
+        input->base_line++;
+        line_start = ++lf;
+    }
+
+    if (line_start)
+        input->base_column = input_columns (line_start, (int)(data + size - line_start), 0);
+    else
+        input->base_column = input_columns (data, size, input->base_column);
+
+    memmove (input->text.data, data + size, (size_t)(input->text.size - size));
+    input->text.size -= size;
+    input->text.hash = 0;
+    input->base += size;
+    input->ofs -= size;
+
+    // The index of lines is relative to the start of text
+    vector_ofs_clear (&input->lines);
+    input->lines_ofs = 0;
+}
+
+bool input_fill (input_t *input)
+{
+    if (input->eof)
+        return false;
+
+    if (input->ofs > 0)
+        input_drop (input, input->ofs);
+
+    // The window grows only if a token doesn't fit into it
+    if (!str_expand (&input->text, input->chunk))
+    {
+        input->eof = input->read_error = true;
+        return false;
+    }
+
+    ssize_t n;
+    do
+        n = read (input->fd, input->text.data + input->text.size,
+                  (size_t)(input->text.allocated - 1 - input->text.size));
+    while ((n < 0) && (errno == EINTR));
+
+    if (n <= 0)
+    {
+        input->eof = true;
+        input->read_error = (n < 0);
+        return false;
+    }
+
+    input->text.size += (int)n;
+    input->text.data [input->text.size] = '\0';
+    return true;
+}
+
+/* Add the starts of all lines up to ofs to the lines index.
+ */
+static bool input_index_lines (input_t *input, int ofs)
+{
+    const char *data = input->text.data;
+
+    while (input->lines_ofs < ofs)
+    {
+        const char *lf = memchr (data + input->lines_ofs, '\n',
+                                 (size_t)(ofs - input->lines_ofs));
+        if (!lf)
+        {
+            input->lines_ofs = ofs;
+            break;
+        }
+
+        int line_start = (int)(lf - data) + 1;
+        if (!vector_ofs_append (&input->lines, &line_start))
+            return false;
+        input->lines_ofs = line_start;
+    }
+
+    return true;
+}
+
+bool input_pos (input_t *input, int ofs, int *line, int *column)
+{
+    // Offsets within text
+    ofs -= input->base;
+    if ((ofs < 0) && (input->base > 0))
+    {
+        *line = *column = -1;
+        return false;
+    }
+
+    if (ofs < 0)
+        ofs = 0;
+    if (ofs > input->text.size)
+        ofs = input->text.size;
+
+    if (!input_index_lines (input, ofs))
+    {
+        *line = *column = -1;
+        return false;
+    }
+
+    // Find the number of lines starting at or before ofs
+    const int *lines = input->lines.data;
+    int l = 0, r = input->lines.size;
+    while (l < r)
+    {
+        int m = (l + r) / 2;
+        if (lines [m] <= ofs)
+            l = m + 1;
+        else
+            r = m;
+    }
+
+    *line = input->base_line + l;
+
+    // Count the columns from the start of the line
+    if (l)
+        *column = input_columns (input->text.data + lines [l - 1], ofs - lines [l - 1], 0);
+    else
+        *column = input_columns (input->text.data, ofs, input->base_column);
+    return true;
+}
+
 void input_push_indent (input_t *input, int indent)
 {
-    vector_append (&input->stmt_indent_vec, (void *)(intptr_t)input->stmt_indent);
+    vector_indent_append (&input->stmt_indent_vec, &input->stmt_indent);
     input->stmt_indent = indent;
 }
 
 void input_pop_indent (input_t *input)
 {
-    void *indent = vector_pop (&input->stmt_indent_vec);
-    input->stmt_indent = (int)(intptr_t)indent;
+    vector_indent_pop (&input->stmt_indent_vec, &input->stmt_indent);
 }
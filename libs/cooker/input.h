@@ -9,32 +9,68 @@
 #define __INPUT_H__
 
 #include "str.h"
-#include "vector.h"
+#include "tvector.h"
+
+/// A stack of statement indents
+VECTOR_DEFINE (vector_indent, int)
+
+/// The distance between tab stops (must be power of two)
+#define INPUT_TAB_SPACES    8
+
+/// The default number of bytes to read at once from a stream
+#define INPUT_CHUNK         (64 * 1024)
+
+/// A list of offsets within text
+VECTOR_DEFINE (vector_ofs, int)
 
 /**
  * Tokenizer input.
  *
  * The pos member can be saved and restored as needed, but it has to
  * refer to same text (obviously).
+ *
+ * The tokenizer tracks only the linear offset within text. Line and
+ * column numbers are needed only for messages, so they are computed
+ * on demand by input_pos() from a index of line starts, which is built
+ * lazily, as far as requested offsets go.
+ *
+ * The text is either the whole script, or a window sliding over a file
+ * (see input_set_fd()). In the latter case the text starts at offset
+ * base in the file, and token offsets are counted from the start
+ * of file, not from the start of text.
  */
 typedef struct
 {
-    /// The whole script text
+    /// The whole script text, or a part of it
     str_t text;
     /// Current (linear) offset within text
     int ofs;
-    /// Current line number (starting from 0)
-    int line;
-    /// Current column number (starting from 0)
-    int column;
     /// Current indent level (number of spaces before 1st token in line)
     int indent;
     /// The indent of next statement (MAX_INT unless set by parser)
     int stmt_indent;
     /// The stack for statement indent values (used for nested statements)
-    vector_t stmt_indent_vec;
+    vector_indent_t stmt_indent_vec;
     /// Identifier (user-comprehensible name, used in error messages)
     str_t name;
+    /// Offsets of the starts of lines 1, 2, ... (line 0 starts at 0)
+    vector_ofs_t lines;
+    /// The text before this offset is already in the lines index
+    int lines_ofs;
+    /// The file to read the text from (-1 if the whole text is in memory)
+    int fd;
+    /// The number of bytes to read from the file at once
+    int chunk;
+    /// false while there's more text to read from the file
+    bool eof;
+    /// true if reading the file failed
+    bool read_error;
+    /// The offset of the text in the file
+    int base;
+    /// The line number at the start of text
+    int base_line;
+    /// The column number at the start of text
+    int base_column;
 } input_t;
 
 /**
@@ -60,6 +96,67 @@ extern void input_done (input_t *input);
  */
 extern void input_set_text (input_t *input, str_t *text, str_t *name);
 
+/**
+ * Set the input to consume the contents of a file.
+ * The file is mapped into memory when possible, so loading even
+ * large scripts costs almost nothing until the text is tokenized.
+ * The file name is used as text identifier.
+ *
+ * @param input The input object to set up.
+ * @param filename The name of the file to load.
+ * @return false if the file cannot be read.
+ */
+extern bool input_set_file (input_t *input, const char *filename);
+
+/**
+ * Set the input to consume a file, reading it in chunks as tokens
+ * are extracted. Only a window over the file is kept in memory,
+ * so the memory used doesn't depend on the file size; the window
+ * grows only to fit a token longer than a chunk.
+ *
+ * Since tokens are slices of the window, a token is valid only
+ * until the next call to input_token(). The file descriptor
+ * must stay open until the input is finalized or set up for
+ * other text; it is not closed by the input.
+ *
+ * @param input The input object to set up.
+ * @param fd The file descriptor to read from.
+ * @param name Text identifier (file name etc).
+ * @param chunk The number of bytes to read at once (0 for the default).
+ * @return false on memory allocation failure.
+ */
+extern bool input_set_fd (input_t *input, int fd, str_t *name, int chunk);
+
+/**
+ * Read more text into the window of a streaming input. The text
+ * before current offset is dropped, so offsets within text change
+ * (but not the offsets from the start of file).
+ *
+ * @param input The input object.
+ * @return false if there's no more text: end of file, not a stream,
+ *      read error or memory allocation failure (the last two also
+ *      set input->read_error).
+ */
+extern bool input_fill (input_t *input);
+
+/**
+ * Get the line and column numbers for a offset within input text.
+ * Columns are counted on screen: tabs advance to the next tab stop
+ * and carriage returns take no place.
+ *
+ * With a streaming input only the offsets within current window
+ * are known (which is enough for the last token extracted).
+ *
+ * @param input The input object.
+ * @param ofs The offset from the start of file (e.g. token->ofs).
+ * @param line Receives the line number (starting from 0).
+ * @param column Receives the column number (starting from 0).
+ * @return false if the offset is not in the window any more,
+ *      or on memory allocation failure (line and column are set
+ *      to -1 then).
+ */
+extern bool input_pos (input_t *input, int ofs, int *line, int *column);
+
 /**
  * Push current statement indent into a stack and set current statement
  * indent to @a indent.
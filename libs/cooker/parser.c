@@ -15,6 +15,9 @@ void parser_init (parser_t *parser, var_t *ctx_root, parser_error_func_t error)
     assert (parser);
 
     input_init (&parser->input);
+    token_buf_init (&parser->tokens);
+    parser->token_idx = 0;
+    parser->errors = 0;
     if (!ctx_root)
         ctx_root = var_get_root_ctx ();
 
@@ -27,6 +30,39 @@ void parser_done (parser_t *parser)
     assert (parser);
 
     input_done (&parser->input);
+    token_buf_done (&parser->tokens);
+}
+
+bool parser_lex (parser_t *parser)
+{
+    assert (parser);
+
+    token_buf_clear (&parser->tokens);
+    parser->token_idx = 0;
+    return token_buf_fill (&parser->tokens, &parser->input);
+}
+
+bool parser_relex (parser_t *parser, str_t *text,
+                   int ofs, int old_size, int new_size)
+{
+    assert (parser && text);
+
+    input_set_text (&parser->input, text, &parser->input.name);
+    parser->token_idx = 0;
+    return token_buf_relex (&parser->tokens, &parser->input,
+                            ofs, old_size, new_size, NULL);
+}
+
+// The parser generated by bison from cook-parser.y
+extern int yyparse (parser_t *parser);
+
+bool parser_parse (parser_t *parser)
+{
+    assert (parser);
+
+    parser->token_idx = 0;
+    parser->errors = 0;
+    return (yyparse (parser) == 0) && (parser->errors == 0);
 }
 
 #if 0
@@ -9,6 +9,7 @@
 #define __PARSER_H__
 
 #include "tokenizer.h"
+#include "token-buf.h"
 #include "var.h"
 
 typedef struct _parser_t parser_t;
@@ -16,15 +17,16 @@ typedef struct _parser_t parser_t;
 /**
  * A location within input text.
  *
- * It is identic to default YYLTYPE, this allows us to just
- * define YYLTYPE_IS_TRIVIAL and rely on default implementation.
+ * Only the offsets within input text are kept, since the location
+ * is computed for every token and every rule. Use input_pos() on
+ * parser->input to get the line and column numbers, if needed.
  */
 typedef struct
 {
-    int first_line;
-    int first_column;
-    int last_line;
-    int last_column;
+    /// The offset of the first character
+    int first_ofs;
+    /// The offset just after the last character
+    int last_ofs;
 } parser_pos_t;
 
 /**
@@ -47,6 +49,12 @@ typedef struct _parser_t
 {
     /// Parser input to extract tokens from.
     input_t input;
+    /// All the tokens of the input (see parser_lex())
+    token_buf_t tokens;
+    /// The index of the next token to parse
+    int token_idx;
+    /// The number of errors found by parser_parse()
+    int errors;
     /// The root context
     var_t *ctx_root;
     /// Current context (pointer somewhere inside the ctx_root tree)
@@ -72,6 +80,41 @@ extern void parser_init (parser_t *parser, var_t *ctx_root,
  */
 extern void parser_done (parser_t *parser);
 
+/**
+ * Tokenize the whole parser input in one go. This must be done
+ * before calling parser_parse(). The input text is set up with
+ * input_set_text() or input_set_file() on parser->input.
+ *
+ * @param parser The parser object.
+ * @return false on memory allocation failure.
+ */
+extern bool parser_lex (parser_t *parser);
+
+/**
+ * Replace a part of the parser input text and update the tokens,
+ * tokenizing only the text around the edit (see token_buf_relex()).
+ * This is a lot faster than parser_lex() when small parts of a large
+ * script are changed.
+ *
+ * @param parser The parser object, after parser_lex().
+ * @param text The new input text.
+ * @param ofs The offset of the replaced part.
+ * @param old_size The size of the replaced part in old text.
+ * @param new_size The size of the replacement in new text.
+ * @return false on memory allocation failure.
+ */
+extern bool parser_relex (parser_t *parser, str_t *text,
+                          int ofs, int old_size, int new_size);
+
+/**
+ * Parse the tokens collected by parser_lex().
+ * Errors are reported through the parser error handler.
+ *
+ * @param parser The parser object.
+ * @return false if the text has syntax errors.
+ */
+extern bool parser_parse (parser_t *parser);
+
 /**
  * Parse a expression.
  *
@@ -0,0 +1,440 @@
+/* The Cook project
+ * A buffer of tokens
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#include "token-buf.h"
+#include "tokenizer.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// The size of all arrays for one token
+#define TOKEN_BUF_ITEM_SIZE (sizeof (str_t *) + 2 * sizeof (int) + 2)
+
+void token_buf_init (token_buf_t *buf)
+{
+    memset (buf, 0, sizeof (token_buf_t));
+}
+
+void token_buf_done (token_buf_t *buf)
+{
+    // sym is the start of the memory block
+    free (buf->sym);
+    token_buf_init (buf);
+}
+
+bool token_buf_reserve (token_buf_t *buf, int size)
+{
+    if (size <= buf->allocated)
+        return true;
+
+    int allocated = buf->allocated ? buf->allocated : 256;
+    while (allocated < size)
+    {
+        if (allocated > INT_MAX / 2)
+            return false;
+        allocated *= 2;
+    }
+
+    // Arrays go in order of decreasing alignment
+    char *block = malloc ((size_t)allocated * TOKEN_BUF_ITEM_SIZE);
+    if (!block)
+        return false;
+
+    token_buf_t tmp = *buf;
+    tmp.sym = (const str_t **)block;
+    tmp.ofs = (int *)(tmp.sym + allocated);
+    tmp.len = tmp.ofs + allocated;
+    tmp.code = (uint8_t *)(tmp.len + allocated);
+    tmp.flags = tmp.code + allocated;
+    tmp.allocated = allocated;
+
+    if (buf->size)
+    {
+        size_t n = (size_t)buf->size;
+        memcpy (tmp.sym, buf->sym, n * sizeof (str_t *));
+        memcpy (tmp.ofs, buf->ofs, n * sizeof (int));
+        memcpy (tmp.len, buf->len, n * sizeof (int));
+        memcpy (tmp.code, buf->code, n);
+        memcpy (tmp.flags, buf->flags, n);
+    }
+
+    free (buf->sym);
+    *buf = tmp;
+    return true;
+}
+
+bool token_buf_append (token_buf_t *buf, const token_t *token)
+{
+    if ((buf->size >= buf->allocated) && !token_buf_reserve (buf, buf->size + 1))
+        return false;
+
+    int idx = buf->size++;
+    buf->sym [idx] = NULL;
+    buf->ofs [idx] = token->ofs;
+    buf->len [idx] = token->text.size;
+    buf->code [idx] = (uint8_t)token->code;
+    buf->flags [idx] = token->escaped ? TOKEN_BUF_ESCAPED : 0;
+    return true;
+}
+
+bool token_buf_fill (token_buf_t *buf, input_t *input)
+{
+    // Tokens refer to the text, so it must be all in memory
+    assert (input->fd < 0);
+
+    // Recipes have roughly one token per three bytes
+    if (!token_buf_reserve (buf, buf->size + (input->text.size - input->ofs) / 3 + 1))
+        return false;
+
+    // Every line break is a candidate for TOK_NEXT
+    int stmt_indent = input->stmt_indent;
+    input->stmt_indent = INT_MAX;
+
+    bool ok = true;
+    token_t token;
+    while (input_token (input, &token))
+    {
+        ok = token_buf_append (buf, &token);
+        token_done (&token);
+        if (!ok)
+            break;
+    }
+
+    input->stmt_indent = stmt_indent;
+    return ok;
+}
+
+// Find the first token starting at or after ofs
+static int token_buf_find (const token_buf_t *buf, int ofs)
+{
+    int l = 0, r = buf->size;
+    while (l < r)
+    {
+        int m = (l + r) / 2;
+        if (buf->ofs [m] < ofs)
+            l = m + 1;
+        else
+            r = m;
+    }
+    return l;
+}
+
+// Copy n tokens from src, starting at from, to buf at pos
+static void token_buf_copy (token_buf_t *buf, int pos,
+                            const token_buf_t *src, int from, int n)
+{
+    if (n <= 0)
+        return;
+
+    size_t size = (size_t)n;
+    memcpy (buf->sym + pos, src->sym + from, size * sizeof (str_t *));
+    memcpy (buf->ofs + pos, src->ofs + from, size * sizeof (int));
+    memcpy (buf->len + pos, src->len + from, size * sizeof (int));
+    memcpy (buf->code + pos, src->code + from, size);
+    memcpy (buf->flags + pos, src->flags + from, size);
+}
+
+/* Replace count tokens at pos with all tokens from src, and shift
+ * the offsets of tokens after them by delta.
+ */
+static bool token_buf_splice (token_buf_t *buf, int pos, int count,
+                              const token_buf_t *src, int delta)
+{
+    int tail = buf->size - pos - count;
+    if (!token_buf_reserve (buf, pos + src->size + tail))
+        return false;
+
+    int to = pos + src->size, from = pos + count;
+    size_t n = (size_t)tail;
+    memmove (buf->sym + to, buf->sym + from, n * sizeof (str_t *));
+    memmove (buf->ofs + to, buf->ofs + from, n * sizeof (int));
+    memmove (buf->len + to, buf->len + from, n * sizeof (int));
+    memmove (buf->code + to, buf->code + from, n);
+    memmove (buf->flags + to, buf->flags + from, n);
+
+    token_buf_copy (buf, pos, src, 0, src->size);
+
+    if (delta)
+        for (int i = to; i < to + tail; i++)
+            buf->ofs [i] += delta;
+
+    buf->size = to + tail;
+    return true;
+}
+
+bool token_buf_relex (token_buf_t *buf, input_t *input,
+                      int ofs, int old_size, int new_size, int *count)
+{
+    // Find the last checkpoint before the edit
+    int first = token_buf_find (buf, ofs);
+    while ((first > 0) && (buf->code [--first] != TOK_NEXT))
+        ;
+    int start = (first < buf->size) ? buf->ofs [first] : 0;
+    if (start >= ofs)
+        first = start = 0;
+
+    int delta = new_size - old_size;
+    int edit_end = ofs + new_size;
+
+    // The first old token which may be reused
+    int last = token_buf_find (buf, ofs + old_size);
+
+    token_buf_t tmp;
+    token_buf_init (&tmp);
+
+    int stmt_indent = input->stmt_indent;
+    input->stmt_indent = INT_MAX;
+    input->ofs = start;
+
+    bool ok = true, synced = false;
+    token_t token;
+    while (input_token (input, &token))
+    {
+        if (token.ofs >= edit_end)
+        {
+            // Look if a old token started here too
+            while ((last < buf->size) && (buf->ofs [last] + delta < token.ofs))
+                last++;
+            if ((last < buf->size) && (buf->ofs [last] + delta == token.ofs))
+            {
+                token_done (&token);
+                synced = true;
+                break;
+            }
+        }
+
+        ok = token_buf_append (&tmp, &token);
+        token_done (&token);
+        if (!ok)
+            break;
+    }
+
+    // Came to the end of text, all old tokens are replaced
+    if (!synced)
+        last = buf->size;
+
+    input->stmt_indent = stmt_indent;
+    // The buffer covers the whole text again
+    input->ofs = input->text.size;
+
+    if (ok)
+        ok = token_buf_splice (buf, first, last - first, &tmp, delta);
+
+    if (count)
+        *count = tmp.size;
+    token_buf_done (&tmp);
+    return ok;
+}
+
+// ---------- // Parallel tokenizing // ---------- //
+
+// A part of text tokenized by a thread
+typedef struct
+{
+    /// The input, pointing to the start of the part
+    input_t input;
+    /// The part contains the tokens starting before this offset
+    int end;
+    /// The tokens of the part
+    token_buf_t tokens;
+    /// false on memory allocation failure
+    bool ok;
+    /// true if the part is tokenized in a new thread
+    bool thread;
+    pthread_t tid;
+} token_buf_part_t;
+
+// Find a line start with no indent after ofs, or the end of text
+static int token_buf_split (const str_t *text, int ofs)
+{
+    const char *data = text->data;
+    int size = text->size;
+
+    while (ofs < size)
+    {
+        const char *eol = memchr (data + ofs, '\n', (size_t)(size - ofs));
+        if (!eol)
+            break;
+
+        ofs = (int)(eol - data) + 1;
+        if (ofs >= size)
+            break;
+
+        char c = data [ofs];
+        if ((c != ' ') && (c != '\t') && (c != '\r') && (c != '\n'))
+            return ofs;
+    }
+
+    return size;
+}
+
+static void *token_buf_part_fill (void *arg)
+{
+    token_buf_part_t *part = arg;
+    input_t *input = &part->input;
+
+    part->ok = token_buf_reserve (&part->tokens, (part->end - input->ofs) / 3 + 1);
+
+    token_t token;
+    while (part->ok && (input->ofs < part->end) && input_token (input, &token))
+    {
+        part->ok = token_buf_append (&part->tokens, &token);
+        token_done (&token);
+    }
+
+    return NULL;
+}
+
+/* Append the tokens of a part to the buffer, which already has all tokens
+ * before input->ofs. If the part does not start exactly there, tokenize
+ * the text until a token of the part starts at the same offset: since the
+ * tokenizer state between tokens is just the offset, all the following
+ * tokens of the part are right.
+ */
+static bool token_buf_join (token_buf_t *buf, input_t *input,
+                            const token_buf_part_t *part)
+{
+    const token_buf_t *tokens = &part->tokens;
+    int idx = token_buf_find (tokens, input->ofs);
+
+    while ((idx < tokens->size) && (tokens->ofs [idx] != input->ofs))
+    {
+        token_t token;
+        if (!input_token (input, &token))
+            return true;
+
+        bool ok = token_buf_append (buf, &token);
+        token_done (&token);
+        if (!ok)
+            return false;
+
+        while ((idx < tokens->size) && (tokens->ofs [idx] < input->ofs))
+            idx++;
+    }
+
+    int count = tokens->size - idx;
+    if (count <= 0)
+        return true;
+
+    if (!token_buf_reserve (buf, buf->size + count))
+        return false;
+
+    token_buf_copy (buf, buf->size, tokens, idx, count);
+    buf->size += count;
+    input->ofs = part->input.ofs;
+    return true;
+}
+
+bool token_buf_fill_parallel (token_buf_t *buf, input_t *input,
+                              int threads, int chunk)
+{
+    assert (input->fd < 0);
+
+    if (threads <= 0)
+        threads = (int)sysconf (_SC_NPROCESSORS_ONLN);
+    if (chunk <= 0)
+        chunk = TOKEN_BUF_CHUNK;
+
+    int start = input->ofs;
+    int size = input->text.size;
+    threads = imin (imin (threads, TOKEN_BUF_THREADS), (size - start) / chunk);
+    if (threads <= 1)
+        return token_buf_fill (buf, input);
+
+    // Split the text into parts of about the same size
+    token_buf_part_t parts [TOKEN_BUF_THREADS];
+    int count = 0;
+    for (int ofs = start; ofs < size; count++)
+    {
+        int end = start + (int)((int64_t)(size - start) * (count + 1) / threads);
+        end = token_buf_split (&input->text, imax (end, ofs + 1));
+
+        token_buf_part_t *part = &parts [count];
+        input_init (&part->input);
+        input_set_text (&part->input, &input->text, &input->name);
+        part->input.ofs = ofs;
+        part->input.stmt_indent = INT_MAX;
+        part->end = end;
+        token_buf_init (&part->tokens);
+        part->ok = true;
+        part->thread = false;
+
+        ofs = end;
+    }
+
+    // The first part is tokenized in this thread
+    for (int i = 1; i < count; i++)
+        parts [i].thread = (pthread_create (&parts [i].tid, NULL,
+                                            token_buf_part_fill, &parts [i]) == 0);
+    token_buf_part_fill (&parts [0]);
+
+    bool ok = true;
+    for (int i = 1; i < count; i++)
+        if (parts [i].thread)
+            pthread_join (parts [i].tid, NULL);
+        else
+            token_buf_part_fill (&parts [i]);
+
+    int stmt_indent = input->stmt_indent;
+    input->stmt_indent = INT_MAX;
+
+    for (int i = 0; i < count; i++)
+        if (ok)
+            ok = parts [i].ok && token_buf_join (buf, input, &parts [i]);
+
+    // The last tokens may be tokenized again past the end of last part
+    token_t token;
+    while (ok && input_token (input, &token))
+    {
+        ok = token_buf_append (buf, &token);
+        token_done (&token);
+    }
+
+    input->stmt_indent = stmt_indent;
+
+    for (int i = 0; i < count; i++)
+    {
+        token_buf_done (&parts [i].tokens);
+        input_done (&parts [i].input);
+    }
+
+    return ok;
+}
+
+// ---------- //
+
+void token_buf_get (const token_buf_t *buf, const input_t *input,
+                    int idx, token_t *token)
+{
+    token_init (token);
+    if ((idx < 0) || (idx >= buf->size))
+        return;
+
+    str_init_c_const (&token->text, input->text.data + buf->ofs [idx], buf->len [idx]);
+    token->code = (token_code_t)buf->code [idx];
+    token->escaped = (buf->flags [idx] & TOKEN_BUF_ESCAPED) != 0;
+    token->ofs = buf->ofs [idx];
+}
+
+const str_t *token_buf_sym (token_buf_t *buf, const input_t *input, int idx)
+{
+    if ((idx < 0) || (idx >= buf->size))
+        return NULL;
+
+    if (!buf->sym [idx])
+    {
+        token_t token;
+        token_buf_get (buf, input, idx, &token);
+        buf->sym [idx] = token_sym (&token);
+    }
+
+    return buf->sym [idx];
+}
@@ -0,0 +1,179 @@
+/* The Cook project
+ * A buffer of tokens
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#ifndef __TOKEN_BUF_H__
+#define __TOKEN_BUF_H__
+
+#include "input.h"
+#include "token.h"
+
+/// The word contains quotes or escapes (see token_unescape())
+#define TOKEN_BUF_ESCAPED   0x01
+
+/// The default minimal size of text to tokenize in a separate thread
+#define TOKEN_BUF_CHUNK     (256 * 1024)
+/// The maximal number of threads token_buf_fill_parallel() uses
+#define TOKEN_BUF_THREADS   64
+
+/**
+ * All tokens of a input text, kept as a structure of arrays.
+ *
+ * Tokens are slices of the input text, so the buffer keeps just
+ * their offsets and lengths, and a token takes 18 bytes instead of
+ * sizeof (token_t). Every field is kept in its own array, so the parser,
+ * which looks mostly at token codes, touches as little memory as possible.
+ * All arrays live in one memory block.
+ *
+ * The buffer refers to the input text, which must live as long
+ * as the buffer is used.
+ */
+typedef struct
+{
+    /// Interned text of plain words, filled by token_buf_sym(), or NULL
+    const str_t **sym;
+    /// Token offsets within input text
+    int *ofs;
+    /// Token lengths
+    int *len;
+    /// Token codes (token_code_t)
+    uint8_t *code;
+    /// Token flags (TOKEN_BUF_XXX)
+    uint8_t *flags;
+    /// Number of tokens in the buffer
+    int size;
+    /// Number of tokens the buffer has space for
+    int allocated;
+} token_buf_t;
+
+/**
+ * Initialize a empty token buffer.
+ *
+ * @param buf The buffer to initialize.
+ */
+extern void token_buf_init (token_buf_t *buf);
+
+/**
+ * Free the memory used by token buffer.
+ *
+ * @param buf The buffer to finalize.
+ */
+extern void token_buf_done (token_buf_t *buf);
+
+/**
+ * Remove all tokens from the buffer, keeping the memory.
+ *
+ * @param buf The buffer to clear.
+ */
+static inline void token_buf_clear (token_buf_t *buf)
+{ buf->size = 0; }
+
+/**
+ * Make sure the buffer may hold @a size tokens without reallocations.
+ *
+ * @param buf The token buffer.
+ * @param size The number of tokens.
+ * @return false on memory allocation failure.
+ */
+extern bool token_buf_reserve (token_buf_t *buf, int size);
+
+/**
+ * Append a token to the end of the buffer.
+ *
+ * @param buf The token buffer.
+ * @param token The token to append (its text must be a slice
+ *      of the input text the buffer refers to).
+ * @return false on memory allocation failure.
+ */
+extern bool token_buf_append (token_buf_t *buf, const token_t *token);
+
+/**
+ * Tokenize all the input, from current position to the end,
+ * and append the tokens to the buffer.
+ *
+ * Tokens are extracted before they are parsed, so the tokenizer cannot
+ * know the indents of statements. Every run of spaces spanning
+ * several lines is stored as TOK_NEXT; it is up to the consumer
+ * to compare its indent (see input_indent()) with current
+ * statement indent.
+ *
+ * @param buf The token buffer.
+ * @param input The input to tokenize (with the whole text in memory,
+ *      not a stream).
+ * @return false on memory allocation failure.
+ */
+extern bool token_buf_fill (token_buf_t *buf, input_t *input);
+
+/**
+ * Same as token_buf_fill(), but tokenize a large text in several
+ * threads. The result is exactly the same as from token_buf_fill().
+ *
+ * The text is split into parts at line starts with no indent (these
+ * are statement boundaries, unless they are inside a multi-line string),
+ * every part is tokenized in its own thread, then the tokens are joined.
+ * If the tokens of a part do not end exactly where the next part starts
+ * (e.g. a string spans the split point), the text after the split point
+ * is tokenized again until the tokens come to a point where a token
+ * of the next part started, and the rest of that part is used as is.
+ *
+ * @param buf The token buffer.
+ * @param input The input to tokenize (with the whole text in memory).
+ * @param threads The number of threads to use (0 for the number
+ *      of processors).
+ * @param chunk The minimal size of text for one thread
+ *      (0 for TOKEN_BUF_CHUNK).
+ * @return false on memory allocation failure.
+ */
+extern bool token_buf_fill_parallel (token_buf_t *buf, input_t *input,
+                                     int threads, int chunk);
+
+/**
+ * Update the tokens after a part of the input text was replaced.
+ *
+ * Since the buffer is filled without statement indents, the tokenizer
+ * state between tokens is just the offset in the text. So every
+ * TOK_NEXT token is a checkpoint: tokenizing restarts at the last one
+ * before the edit, and stops as soon as it comes to a point after
+ * the edit where a old token (moved by the edit) started. The rest
+ * of the old tokens are kept, only their offsets are shifted.
+ *
+ * @param buf The token buffer, filled from the old text.
+ * @param input The input containing the new text.
+ * @param ofs The offset of the replaced part.
+ * @param old_size The size of the replaced part in old text.
+ * @param new_size The size of the replacement in new text.
+ * @param count If not NULL, receives the number of tokens extracted
+ *      from the new text.
+ * @return false on memory allocation failure (the buffer
+ *      contents is undefined then).
+ */
+extern bool token_buf_relex (token_buf_t *buf, input_t *input,
+                             int ofs, int old_size, int new_size, int *count);
+
+/**
+ * Get a token from the buffer.
+ *
+ * @param buf The token buffer.
+ * @param input The input the tokens come from.
+ * @param idx The index of the token.
+ * @param token The token to initialize (no memory is allocated).
+ */
+extern void token_buf_get (const token_buf_t *buf, const input_t *input,
+                           int idx, token_t *token);
+
+/**
+ * Get the interned text of a plain word from the buffer (see token_sym()).
+ * The symbol is looked up on first use and kept in the buffer.
+ *
+ * @param buf The token buffer.
+ * @param input The input the tokens come from.
+ * @param idx The index of the token.
+ * @return The symbol, or NULL if the token is not a plain word
+ *      or on memory allocation failure.
+ */
+extern const str_t *token_buf_sym (token_buf_t *buf, const input_t *input, int idx);
+
+#endif /* __TOKEN_BUF_H__ */
@@ -6,6 +6,7 @@
  */
 
 #include "token.h"
+#include "intern.h"
 
 #include <string.h>
 
@@ -48,4 +49,150 @@ void token_copy (token_t *to, token_t *from)
 
     str_set (&to->text, &from->text);
     to->code = from->code;
+    to->escaped = from->escaped;
+    to->ofs = from->ofs;
+}
+
+// Parse the digits of a \u or \x escape up to ';'
+static bool token_parse_code (const char **src, const char *end, int base, uint32_t *code)
+{
+    uint32_t value = 0;
+    const char *p = *src;
+    for (; (p < end) && (*p != ';'); p++)
+    {
+        int digit;
+        if ((*p >= '0') && (*p <= '9'))
+            digit = *p - '0';
+        else if ((*p >= 'a') && (*p <= 'f'))
+            digit = *p - 'a' + 10;
+        else if ((*p >= 'A') && (*p <= 'F'))
+            digit = *p - 'A' + 10;
+        else
+            return false;
+
+        if (digit >= base)
+            return false;
+
+        value = value * (uint32_t)base + (uint32_t)digit;
+        // Don't let it overflow
+        if (value > 0x10ffff)
+            return false;
+    }
+
+    if (p >= end)
+        return false;
+
+    *src = p + 1;
+    *code = value;
+    return true;
+}
+
+// Encode a Unicode character in UTF-8
+static bool token_put_utf8 (char **dst, uint32_t code)
+{
+    uint8_t *out = (uint8_t *)*dst;
+
+    if ((code >= 0xd800) && (code <= 0xdfff))
+        return false;
+
+    if (code < 0x80)
+        *out++ = (uint8_t)code;
+    else if (code < 0x800)
+    {
+        *out++ = (uint8_t)(0xc0 | (code >> 6));
+        *out++ = (uint8_t)(0x80 | (code & 0x3f));
+    }
+    else if (code < 0x10000)
+    {
+        *out++ = (uint8_t)(0xe0 | (code >> 12));
+        *out++ = (uint8_t)(0x80 | ((code >> 6) & 0x3f));
+        *out++ = (uint8_t)(0x80 | (code & 0x3f));
+    }
+    else
+    {
+        *out++ = (uint8_t)(0xf0 | (code >> 18));
+        *out++ = (uint8_t)(0x80 | ((code >> 12) & 0x3f));
+        *out++ = (uint8_t)(0x80 | ((code >> 6) & 0x3f));
+        *out++ = (uint8_t)(0x80 | (code & 0x3f));
+    }
+
+    *dst = (char *)out;
+    return true;
+}
+
+bool token_unescape (const token_t *token, str_t *value)
+{
+    const char *src = token->text.data;
+    const char *end = src + token->text.size;
+
+    if (!token->escaped)
+    {
+        str_init_c_const (value, src, token->text.size);
+        return true;
+    }
+
+    // The value is never longer than the source text
+    if (!str_init_alloc (value, token->text.size))
+        return false;
+
+    char *dst = value->data;
+    bool quoted = false;
+    while (src < end)
+    {
+        char c = *src++;
+
+        if (c == '"')
+        {
+            // A double double quote inside quotes is a quote
+            if (quoted && (src < end) && (*src == '"'))
+                *dst++ = *src++;
+            else
+                quoted = !quoted;
+            continue;
+        }
+
+        if (quoted || (c != '\\') || (src >= end))
+        {
+            *dst++ = c;
+            continue;
+        }
+
+        uint32_t code;
+        switch (c = *src++)
+        {
+            case 'a': *dst++ = '\a'; break;
+            case 'b': *dst++ = '\b'; break;
+            case 't': *dst++ = '\t'; break;
+            case 'n': *dst++ = '\n'; break;
+            case 'r': *dst++ = '\r'; break;
+            case 'e': *dst++ = '\033'; break;
+            case 's': *dst++ = ' '; break;
+
+            case 'u':
+            case 'x':
+                if (!token_parse_code (&src, end, (c == 'u') ? 10 : 16, &code) ||
+                    !token_put_utf8 (&dst, code))
+                {
+                    str_done (value);
+                    return false;
+                }
+                break;
+
+            default:
+                *dst++ = c;
+                break;
+        }
+    }
+
+    value->size = (int)(dst - value->data);
+    value->data [value->size] = '\0';
+    return true;
+}
+
+const str_t *token_sym (const token_t *token)
+{
+    if ((token->code != TOK_WORD) || token->escaped)
+        return NULL;
+
+    return str_intern (&token->text);
 }
@@ -47,8 +47,10 @@ typedef enum
 
 /**
  * A single token from the input file.
- * The 'text' field usually uses copy-on-write semantics,
- * so it takes up little memory.
+ * The 'text' field is a constant slice of the input text, so tokens
+ * take no memory at all; the input text must live as long as tokens.
+ * Words with quotes and escapes are kept exactly as they were written,
+ * use token_unescape() to get their value.
  */
 typedef struct
 {
@@ -56,10 +58,10 @@ typedef struct
     str_t text;
     /// Token code
     token_code_t code;
-    /// The starting line of the token (copied from input->line)
-    int line;
-    /// The starting column of the token (copied from input->column)
-    int column;
+    /// true if the word contains quotes or escapes (see token_unescape())
+    bool escaped;
+    /// The offset of the token in input text (see input_pos())
+    int ofs;
 } token_t;
 
 /**
@@ -81,6 +83,37 @@ extern void token_done (token_t *token);
  */
 extern const char *token_name (token_code_t code);
 
+/**
+ * Get the value of a word token. Quotes are removed (a doubled
+ * double quote inside quotes stands for the quote itself), and outside
+ * of quotes escape sequences are replaced by what they mean:
+ * @li \\a, \\b, \\t, \\n, \\r, \\e - BEL, BS, TAB, LF, CR, ESC;
+ * @li \\s - space;
+ * @li \\u&lt;decimal&gt;; and \\x&lt;hex&gt;; - the UTF-8 encoding
+ *     of the Unicode character with given code;
+ * @li backslash followed by any other character - the character itself.
+ *
+ * Words without quotes and escapes are not copied.
+ *
+ * @param token The word token.
+ * @param value The string to initialize with the value of the word.
+ * @return false if the word contains a invalid character code
+ *      or on memory allocation failure.
+ */
+extern bool token_unescape (const token_t *token, str_t *value);
+
+/**
+ * Get the interned text (see str_intern()) of a word without quotes
+ * and escapes. The tokenizer does not intern words by itself, so
+ * tokenizing never allocates memory and the symbol table gets only
+ * the words which are actually used as names.
+ *
+ * @param token The word token.
+ * @return The symbol, or NULL if the token is not a plain word
+ *      or on memory allocation failure.
+ */
+extern const str_t *token_sym (const token_t *token);
+
 /**
  * Copy the token.
  * @param to The token to copy TO. The token must be initialized.
@@ -6,43 +6,267 @@
  */
 
 #include "tokenizer.h"
+#include "charset.h"
 
 #include <string.h>
 #include <assert.h>
 #include <limits.h>
 
-// must be power of two
-static const int cook_tab_spaces = 8;
-static const char cook_stop_characters [] = " \t\r\n#,{}=$";
-static const char cook_allowed_escapes [] = "abtnre{}$\"s#.,=+-?\\ux";
+/* The tokenizer is driven by tables, which are built at compile time.
+ * Every input character is mapped to a character class, then the class
+ * selects the token to start (cook_start) or, inside a word, the action
+ * for current word state (cook_word_action).
+ */
+
+// Character classes
+typedef enum
+{
+    /// Ordinary word character
+    CC_WORD,
+    /// ' '
+    CC_BLANK,
+    /// '\t'
+    CC_TAB,
+    /// '\r'
+    CC_CR,
+    /// '\n'
+    CC_LF,
+    /// '#'
+    CC_HASH,
+    /// '='
+    CC_ASSIGN,
+    /// '$'
+    CC_DOLLAR,
+    /// '{'
+    CC_BRACE_OPEN,
+    /// '}'
+    CC_BRACE_CLOSE,
+    /// ','
+    CC_COMMA,
+    /// '+'
+    CC_PLUS,
+    /// '-'
+    CC_MINUS,
+    /// '?'
+    CC_QUEST,
+    /// '"'
+    CC_QUOTE,
+    /// '\\'
+    CC_BACKSLASH,
+
+    CC_COUNT
+} cook_class_t;
+
+static const uint8_t cook_class [256] =
+{
+    [' '] = CC_BLANK,
+    ['\t'] = CC_TAB,
+    ['\r'] = CC_CR,
+    ['\n'] = CC_LF,
+    ['#'] = CC_HASH,
+    ['='] = CC_ASSIGN,
+    ['$'] = CC_DOLLAR,
+    ['{'] = CC_BRACE_OPEN,
+    ['}'] = CC_BRACE_CLOSE,
+    [','] = CC_COMMA,
+    ['+'] = CC_PLUS,
+    ['-'] = CC_MINUS,
+    ['?'] = CC_QUEST,
+    ['"'] = CC_QUOTE,
+    ['\\'] = CC_BACKSLASH,
+};
+
+// Character flags
+/// The character is allowed after a backslash
+#define CF_ESCAPE   0x01
+/// A digit of \u escape
+#define CF_DEC      0x02
+/// A digit of \x escape
+#define CF_HEX      0x04
+
+static const uint8_t cook_flags [256] =
+{
+    ['0' ... '9'] = CF_DEC | CF_HEX,
+    ['A' ... 'F'] = CF_HEX,
+    ['a'] = CF_ESCAPE | CF_HEX,
+    ['b'] = CF_ESCAPE | CF_HEX,
+    ['c' ... 'd'] = CF_HEX,
+    ['e'] = CF_ESCAPE | CF_HEX,
+    ['f'] = CF_HEX,
+    ['t'] = CF_ESCAPE, ['n'] = CF_ESCAPE, ['r'] = CF_ESCAPE,
+    ['s'] = CF_ESCAPE, ['u'] = CF_ESCAPE, ['x'] = CF_ESCAPE,
+    ['{'] = CF_ESCAPE, ['}'] = CF_ESCAPE, ['$'] = CF_ESCAPE,
+    ['"'] = CF_ESCAPE, ['#'] = CF_ESCAPE, ['.'] = CF_ESCAPE,
+    [','] = CF_ESCAPE, ['='] = CF_ESCAPE, ['+'] = CF_ESCAPE,
+    ['-'] = CF_ESCAPE, ['?'] = CF_ESCAPE, ['\\'] = CF_ESCAPE,
+};
+
+/* The same classes as charsets (see charset.h), built at compile time
+ * like the tables above. Runs of spaces and of ordinary word characters
+ * longer than COOK_SHORT_RUN are scanned 16 or 32 bytes at a time.
+ * Most runs are shorter, and those are cheaper to scan with the table.
+ */
+#define COOK_SHORT_RUN      16
+// The bit for character c in word w of the charset_t bitmap
+#define COOK_BIT(c, w)      ((((c) >> 6) == (w)) ? 1ULL << ((c) & 63) : 0)
+#define COOK_SPECIAL(w) \
+    (COOK_BIT (' ', w) | COOK_BIT ('\t', w) | COOK_BIT ('\r', w) | \
+     COOK_BIT ('\n', w) | COOK_BIT ('#', w) | COOK_BIT ('=', w) | \
+     COOK_BIT ('$', w) | COOK_BIT ('{', w) | COOK_BIT ('}', w) | \
+     COOK_BIT (',', w) | COOK_BIT ('+', w) | COOK_BIT ('-', w) | \
+     COOK_BIT ('?', w) | COOK_BIT ('"', w) | COOK_BIT ('\\', w))
+
+// ' '
+static const charset_t cook_blank_set =
+{
+    { COOK_BIT (' ', 0), 0, 0, 0 }, 1, false, " "
+};
+
+// Everything but CC_WORD
+static const charset_t cook_special_set =
+{
+    { COOK_SPECIAL (0), COOK_SPECIAL (1), 0, 0 }, 15, false, " \t\r\n#=${},+-?\"\\"
+};
+
+static inline cook_class_t cook_char_class (char c)
+{ return cook_class [(uint8_t)c]; }
+
+static inline bool cook_char_is (char c, uint8_t flags)
+{ return (cook_flags [(uint8_t)c] & flags) != 0; }
+
+// What a character starts
+typedef struct
+{
+    /// The token for the character alone, TOK_WORD if it starts a word
+    uint8_t code;
+    /// The second character of a two-character operator or 0
+    char second;
+    /// The token for the two-character operator
+    uint8_t code2;
+} cook_start_t;
+
+static const cook_start_t cook_start [CC_COUNT] =
+{
+    [CC_WORD] = { TOK_WORD },
+    [CC_HASH] = { TOK_COMMENT },
+    [CC_ASSIGN] = { TOK_ASSIGN },
+    [CC_DOLLAR] = { TOK_SIMPLE_UNVEIL, '{', TOK_UNVEIL },
+    [CC_BRACE_OPEN] = { TOK_BRACE_OPEN },
+    [CC_BRACE_CLOSE] = { TOK_BRACE_CLOSE },
+    [CC_COMMA] = { TOK_COMMA },
+    [CC_PLUS] = { TOK_WORD, '=', TOK_APPEND },
+    [CC_MINUS] = { TOK_WORD, '=', TOK_EXCLUDE },
+    [CC_QUEST] = { TOK_WORD, '=', TOK_COND_ASSIGN },
+    [CC_QUOTE] = { TOK_WORD },
+    [CC_BACKSLASH] = { TOK_WORD },
+};
+
+// Word states
+typedef enum
+{
+    /// Outside of double quotes
+    WS_PLAIN,
+    /// Inside double quotes
+    WS_QUOTED,
+
+    WS_COUNT
+} cook_word_state_t;
+
+// Actions on a character inside a word
+typedef enum
+{
+    /// Append a run of characters to the word
+    WA_COPY,
+    /// The character ends the word
+    WA_STOP,
+    /// Ends the word if followed by '=' (+= -= ?=)
+    WA_OPERATOR,
+    /// Opening or closing double quote
+    WA_QUOTE,
+    /// A escape sequence
+    WA_ESCAPE,
+} cook_word_action_t;
+
+static const uint8_t cook_word_action [WS_COUNT][CC_COUNT] =
+{
+    [WS_PLAIN] =
+    {
+        [CC_WORD] = WA_COPY,
+        [CC_BLANK] = WA_STOP,
+        [CC_TAB] = WA_STOP,
+        [CC_CR] = WA_STOP,
+        [CC_LF] = WA_STOP,
+        [CC_HASH] = WA_STOP,
+        [CC_ASSIGN] = WA_STOP,
+        [CC_DOLLAR] = WA_STOP,
+        [CC_BRACE_OPEN] = WA_STOP,
+        [CC_BRACE_CLOSE] = WA_STOP,
+        [CC_COMMA] = WA_STOP,
+        [CC_PLUS] = WA_OPERATOR,
+        [CC_MINUS] = WA_OPERATOR,
+        [CC_QUEST] = WA_OPERATOR,
+        [CC_QUOTE] = WA_QUOTE,
+        [CC_BACKSLASH] = WA_ESCAPE,
+    },
+    // Everything is copied verbatim up to the closing quote
+    [WS_QUOTED] =
+    {
+        [CC_QUOTE] = WA_QUOTE,
+    },
+};
+
+int input_indent (const str_t *spaces)
+{
+    int line_start = spaces->size;
+    while ((line_start > 0) && (spaces->data [line_start - 1] != '\n'))
+        line_start--;
+
+    if (line_start == 0)
+        return -1;
+
+    int indent = 0;
+    for (int i = line_start; i < spaces->size; i++)
+        if (spaces->data [i] == ' ')
+            indent++;
+        else if (spaces->data [i] == '\t')
+            indent = (indent + INPUT_TAB_SPACES) & ~(INPUT_TAB_SPACES - 1);
+
+    return indent;
+}
 
 static bool cook_spaces (input_t *input, token_t *token)
 {
-    token->line = input->line;
-    token->column = input->column;
-    int start_ofs = input->ofs;
+    token->ofs = input->ofs;
+    const char *data = input->text.data;
 
     token->code = TOK_SPACE;
 
+    // true if spaces span across newline
+    bool newline = false;
+
     while (input->ofs < input->text.size)
     {
-        switch (input->text.data [input->ofs])
+        switch (cook_char_class (data [input->ofs]))
         {
-            case ' ':
-                input->column++;
-                break;
-
-            case '\t':
-                input->column = (input->column + cook_tab_spaces)
-                        & ~(cook_tab_spaces - 1);
-                break;
+            case CC_BLANK:
+            {
+                // Skip the whole run of spaces at once
+                int end = input->ofs + 1;
+                int probe = imin (end + COOK_SHORT_RUN, input->text.size);
+                while ((end < probe) && (data [end] == ' '))
+                    end++;
+                if (end == probe)
+                    end = str_span (&input->text, end, &cook_blank_set);
+                input->ofs = end;
+                continue;
+            }
 
-            case '\r':
+            case CC_TAB:
+            case CC_CR:
                 break;
 
-            case '\n':
-                input->line++;
-                input->column = 0;
+            case CC_LF:
+                newline = true;
                 break;
 
             default:
@@ -53,23 +277,23 @@ static bool cook_spaces (input_t *input, token_t *token)
         input->ofs++;
     }
 
-done:
+done:;
+    int length = input->ofs - token->ofs;
+    if (length == 0)
+        return false;
+
+    str_init_c_const (&token->text, data + token->ofs, length);
+
     // If spaces span across newline
-    if (token->line != input->line)
+    if (newline)
     {
-        input->indent = input->column;
+        input->indent = input_indent (&token->text);
 
         // and end before the next_indent, it's a NEXT
         if (input->indent <= input->stmt_indent)
             token->code = TOK_NEXT;
     }
 
-    int length = input->ofs - start_ofs;
-    if (length == 0)
-        return false;
-
-    str_init_c_const (&token->text, input->text.data + start_ofs, length);
-
     return true;
 }
 
@@ -82,78 +306,34 @@ static void cook_comment (input_t *input, token_t *token)
 
     // we don't care if we found \n or not...
     int comment_size = input->ofs - start_ofs;
-    input->column += comment_size;
 
     str_init_c_const (&token->text, input->text.data + start_ofs, comment_size);
     token->code = TOK_COMMENT;
 }
 
-// Got a single-character operator
-static void cook_operator_1 (input_t *input, token_t *token, token_code_t code)
+// Got a operator of given length
+static void cook_operator (input_t *input, token_t *token, token_code_t code, int length)
 {
-    str_init_c_const (&token->text, input->text.data + input->ofs, 1);
+    str_init_c_const (&token->text, input->text.data + input->ofs, length);
     token->code = code;
 
-    input->ofs++;
-    input->column++;
+    input->ofs += length;
 }
 
-// Two-character operator
-static bool cook_operator_2 (input_t *input, token_t *token,
-                             char second, token_code_t code)
+// Skip the digits of a \u or \x escape, return true if followed by ';'
+static bool input_skip_entity (input_t *input, int *pos, uint8_t allowed_chars)
 {
-    int ofs = input->ofs + 1;
-    if (ofs >= input->text.size)
-        return false;
-
-    if (input->text.data [ofs] != second)
-        return false;
-
-    str_init_c_const (&token->text, input->text.data + input->ofs, 2);
-    token->code = code;
+    int end = *pos + 1;
+    while ((end < input->text.size) && cook_char_is (input->text.data [end], allowed_chars))
+        end++;
 
-    input->ofs += 2;
-    input->column += 2;
-
-    return true;
-}
-
-static void token_append_char (token_t *token, input_t *input, int *pos)
-{
-    const char *cptr = input->text.data + *pos;
-    str_append_c_const (&token->text, cptr, 1);
-    if (*cptr == '\n')
-    {
-        input->line++;
-        input->column = 0;
-    }
-    else
-        input->column++;
-
-    (*pos)++;
-}
-
-static bool token_append_entity (
-        token_t *token, input_t *input, int *pos, const char *allowed_chars)
-{
-    while (true)
-    {
-        token_append_char (token, input, pos);
-        if (*pos >= input->text.size)
-            return false;
-
-        char c = input->text.data [*pos];
-
-        // ';' ends entity
-        if (c == ';')
-            return true;
+    *pos = end;
 
-        if (!strchr (allowed_chars, c))
-            return false;
-    }
+    // ';' ends entity
+    return (end < input->text.size) && (input->text.data [end] == ';');
 }
 
-bool input_token (input_t *input, token_t *token)
+static bool cook_token (input_t *input, token_t *token)
 {
     token_init (token);
 
@@ -164,143 +344,131 @@ bool input_token (input_t *input, token_t *token)
     if (input->ofs >= input->text.size)
         return false;
 
-    switch (input->text.data [input->ofs])
-    {
-        case '#':
-            cook_comment (input, token);
-            return true;
-
-        case '=':
-            cook_operator_1 (input, token, TOK_ASSIGN);
-            return true;
-
-        case '?':
-            if (cook_operator_2 (input, token, '=', TOK_COND_ASSIGN))
-                return true;
-            break;
+    const char *data = input->text.data;
+    int size = input->text.size;
+    const cook_start_t *start = &cook_start [cook_char_class (data [input->ofs])];
 
-        case '+':
-            if (cook_operator_2 (input, token, '=', TOK_APPEND))
-                return true;
-            break;
+    // Two-character operators
+    if (start->second && (input->ofs + 1 < size) &&
+        (data [input->ofs + 1] == start->second))
+    {
+        cook_operator (input, token, start->code2, 2);
+        return true;
+    }
 
-        case '-':
-            if (cook_operator_2 (input, token, '=', TOK_EXCLUDE))
-                return true;
+    switch (start->code)
+    {
+        case TOK_WORD:
             break;
 
-        case '$':
-            if (cook_operator_2 (input, token, '{', TOK_UNVEIL))
-                return true;
-            cook_operator_1 (input, token, TOK_SIMPLE_UNVEIL);
-            return true;
-
-        case '{':
-            cook_operator_1 (input, token, TOK_BRACE_OPEN);
-            return true;
-
-        case '}':
-            cook_operator_1 (input, token, TOK_BRACE_CLOSE);
+        case TOK_COMMENT:
+            cook_comment (input, token);
             return true;
 
-        case ',':
-            cook_operator_1 (input, token, TOK_COMMA);
+        default:
+            cook_operator (input, token, start->code, 1);
             return true;
     }
 
     // otherwise it's a word...
-    str_init (&token->text);
     token->code = TOK_WORD;
 
     int ofs = input->ofs;
-    bool dquotes = false;
+    cook_word_state_t state = WS_PLAIN;
+    // true if the word contains quotes or escapes
+    bool escaped = false;
 
-    while (ofs < input->text.size)
+    while (ofs < size)
     {
-        char c = input->text.data [ofs];
+        char c = data [ofs];
 
-        if (dquotes)
+        switch (cook_word_action [state][cook_char_class (c)])
         {
-            if (c == '"')
+            case WA_COPY:
             {
-                ofs++;
-                input->column++;
-
-                if ((ofs < input->text.size) &&
-                    (input->text.data [ofs] == '"'))
+                // Skip runs of ordinary characters in one go
+                if (state == WS_PLAIN)
                 {
-                    // That's a double double quote :)
+                    int probe = imin (ofs + 1 + COOK_SHORT_RUN, size);
+                    for (ofs++; (ofs < probe) && (cook_char_class (data [ofs]) == CC_WORD); ofs++)
+                        ;
+                    if (ofs == probe)
+                        ofs = str_find_any (&input->text, ofs, &cook_special_set);
                 }
                 else
                 {
-                    // That's the finishing double quote
-                    dquotes = false;
-                    continue;
+                    const char *quote = memchr (data + ofs + 1, '"', (size_t)(size - ofs - 1));
+                    ofs = quote ? (int)(quote - data) : size;
                 }
+                continue;
             }
-        }
-        else if (c == '\\')
-        {
-            // Place the backslash into the output word.
-            // Unquoting happens later, when we use the word.
-            token_append_char (token, input, &ofs);
 
-            if (ofs >= input->text.size)
-                goto error;
+            case WA_STOP:
+                // A stop character cannot come first in a word
+                assert (ofs > input->ofs);
+                goto word_done;
 
-            c = input->text.data [ofs];
-            const char *escape = strchr (cook_allowed_escapes, c);
+            case WA_OPERATOR:
+                // += -= ?= end the word
+                if ((ofs + 1 < size) && (data [ofs + 1] == '='))
+                {
+                    // An operator cannot come first in a word
+                    assert (ofs > input->ofs);
+                    goto word_done;
+                }
 
-            // Invalid escape, that's a fatal error
-            if (!escape)
-                goto error;
+                ofs++;
+                continue;
 
-            // unicode decimal escape \u[0-9]+;
-            // or hexadecimal escape \x[0-9a-fA-F]+;
-            if (((c == 'u') &&
-                 !token_append_entity (token, input, &ofs, "0123456789")) ||
-                ((c == 'x') &&
-                 !token_append_entity (token, input, &ofs, "0123456789ABCDEFabcdef")))
-                goto error;
+            case WA_QUOTE:
+                escaped = true;
+                ofs++;
 
-            // just append the quote code to output word...
-        }
-        else if (c == '"')
-        {
-            dquotes = true;
-            ofs++;
-            input->column++;
-            continue;
-        }
-        else if (strchr (cook_stop_characters, c))
-        {
-            // A stop character cannot come first in a word
-            assert (token->text.size != 0);
+                if (state == WS_PLAIN)
+                    state = WS_QUOTED;
+                else if ((ofs < size) && (data [ofs] == '"'))
+                    // That's a double double quote :)
+                    ofs++;
+                else
+                    // That's the finishing double quote
+                    state = WS_PLAIN;
+                continue;
 
-            // Break word parsing
-            break;
-        }
-        // += -= ?=
-        else if (((c == '+') || (c == '-') || (c == '?')) &&
-                 (ofs + 1 < input->text.size))
-        {
-            // Check if next character is a '='
-            c = input->text.data [ofs + 1];
-            if (c == '=')
-            {
-                // A stop character cannot come first in a word
-                assert (token->text.size != 0);
-                
-                // Break word parsing
-                break;
-            }
-        }
+            case WA_ESCAPE:
+                escaped = true;
+
+                // Skip the backslash, unescaping happens later,
+                // when the word is used (see token_unescape()).
+                ofs++;
+
+                if (ofs >= size)
+                    goto error;
 
-        token_append_char (token, input, &ofs);
+                c = data [ofs];
+
+                // Invalid escape, that's a fatal error
+                if (!cook_char_is (c, CF_ESCAPE))
+                    goto error;
+
+                // unicode decimal escape \u[0-9]+;
+                // or hexadecimal escape \x[0-9a-fA-F]+;
+                if (((c == 'u') && !input_skip_entity (input, &ofs, CF_DEC)) ||
+                    ((c == 'x') && !input_skip_entity (input, &ofs, CF_HEX)))
+                    goto error;
+
+                // skip the escape code
+                ofs++;
+                continue;
+        }
     }
 
-    if (!dquotes)
+word_done:
+    if (state == WS_PLAIN)
     {
+        // The word is just a slice of the input text
+        str_init_c_const (&token->text, data + input->ofs, ofs - input->ofs);
+        token->escaped = escaped;
+
         input->ofs = ofs;
         return true;
     }
@@ -308,8 +476,33 @@ bool input_token (input_t *input, token_t *token)
     // Unterminated ", that's a fatal error
 
 error:
-    str_done (&token->text);
     token->code = TOK_ERROR;
     input->ofs = ofs;
     return true;
 }
+
+bool input_token (input_t *input, token_t *token)
+{
+    for (;;)
+    {
+        int start = input->ofs;
+        bool ok = cook_token (input, token);
+
+        /* A token which ends at the end of text may continue in the part
+         * of a file which is not read yet. The tokenizer never looks more
+         * than one character ahead, so this covers also all the cases
+         * where the decision depends on the next character ($ vs ${ etc).
+         */
+        if (input->eof || (input->ofs < input->text.size))
+        {
+            // Token offsets are counted from the start of file
+            token->ofs += input->base;
+            return ok;
+        }
+
+        // Read more text and try again
+        token_done (token);
+        input->ofs = start;
+        input_fill (input);
+    }
+}
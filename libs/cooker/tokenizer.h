@@ -21,4 +21,13 @@
  */
 extern bool input_token (input_t *input, token_t *token);
 
+/**
+ * Get the indent of the line a run of spaces ends on.
+ *
+ * @param spaces The text of a TOK_SPACE or TOK_NEXT token.
+ * @return The number of columns after the last newline, or -1
+ *      if the spaces don't span several lines.
+ */
+extern int input_indent (const str_t *spaces);
+
 #endif /* __TOKENIZER_H__ */
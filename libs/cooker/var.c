@@ -11,21 +11,24 @@
 #include <string.h>
 #include <assert.h>
 
-void var_init (var_t *var, str_t *name)
+bool var_init (var_t *var, const str_t *name)
 {
     assert (var);
 
-    str_init_copy (&var->name, name);
-    vector_atom_init (&var->value);
+    var->name = str_intern (name);
+    pvector_atom_init (&var->value);
     vector_var_init (&var->fields);
+    var->parent = NULL;
+
+    return var->name != NULL;
 }
 
 void var_done (var_t *var)
 {
     assert (var);
 
-    str_done (&var->name);
-    vector_done (&var->value);
+    var->name = NULL;
+    pvector_done (&var->value);
     vector_done (&var->fields);
 }
 
@@ -37,6 +40,41 @@ void var_free (var_t *var)
     free (var);
 }
 
+void var_set_value (var_t *var, const pvector_t *value)
+{
+    assert (var && value);
+
+    pvector_set (&var->value, value);
+}
+
+bool var_append_value (var_t *var, const pvector_t *value)
+{
+    assert (var && value);
+
+    // Nothing to append to, just share the whole value
+    if (!var->value.size)
+    {
+        pvector_set (&var->value, value);
+        return true;
+    }
+
+    return pvector_join (&var->value, value);
+}
+
+bool var_fields_merge (var_t *var, vector_var_t *fields, vector_dup_t dup)
+{
+    assert (var && fields);
+
+    if (!vector_insert_sorted_bulk (&var->fields, fields, dup))
+        return false;
+
+    // Only now we know which fields made it into the variable
+    for (int i = 0; i < var->fields.size; i++)
+        ((var_t *)var->fields.data [i])->parent = (struct var_t *)var;
+
+    return true;
+}
+
 // ---------- // ---------- // ---------- // ---------- // ---------- //
 
 static void vector_var_free (void *item);
@@ -55,14 +93,32 @@ static void vector_var_free (void *item)
     var_free (item);
 }
 
+/* Same interned name is same pointer. Different names are ordered
+ * by their hashes, which interned names always have precomputed, so
+ * the text is compared only on a hash collision. The order does not
+ * depend on memory addresses, so it's the same on every run.
+ */
+static inline int var_name_cmp (const str_t *name1, const str_t *name2)
+{
+    if (name1 == name2)
+        return 0;
+
+    uint64_t hash1 = name1->hash ? name1->hash : str_hash_c (name1->data, name1->size);
+    uint64_t hash2 = name2->hash ? name2->hash : str_hash_c (name2->data, name2->size);
+    if (hash1 != hash2)
+        return (hash1 > hash2) - (hash1 < hash2);
+
+    return str_cmp (name1, name2);
+}
+
 static int vector_var_compare (const void *item1, const void *item2)
 {
-    return str_cmp (&((var_t *)item1)->name, &((var_t *)item2)->name);
+    return var_name_cmp (((var_t *)item1)->name, ((var_t *)item2)->name);
 }
 
 static int vector_var_compare_key (const void *item, const void *key)
 {
-    return str_cmp (&((var_t *)item)->name, (str_t *)key);
+    return var_name_cmp (((var_t *)item)->name, key);
 }
 
 void vector_var_init (vector_t *vector)
@@ -80,15 +136,15 @@ static var_t cook_ctx_root;
 var_t *var_get_root_ctx ()
 {
     // If root context is uninitialized yet, initialize it now
-    if (!cook_ctx_root.name.data)
-        var_init (&cook_ctx_root, (str_t *)&ctx_root_ctx_name);
+    if (!cook_ctx_root.name)
+        var_init (&cook_ctx_root, &ctx_root_ctx_name);
 
     return &cook_ctx_root;
 }
 
 void var_done_root_ctx ()
 {
-    if (cook_ctx_root.name.data)
+    if (cook_ctx_root.name)
         var_done (&cook_ctx_root);
 
     memset (&cook_ctx_root, 0, sizeof (cook_ctx_root));
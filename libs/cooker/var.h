@@ -9,6 +9,7 @@
 #define __VAR_H__
 
 #include "strvec.h"
+#include "intern.h"
 #include "atom.h"
 
 /// A vector of var_t's
@@ -16,7 +17,12 @@ typedef vector_t vector_var_t;
 
 /**
  * Initialize a vector of var_t objects.
- * Automatic free & sorting is implemented.
+ * Automatic free & sorting is implemented. Variables are sorted
+ * by the hash of their names (see str_hash()), so the order is not
+ * alphabetical, but same on every run. The search key for
+ * vector_find_sorted_key() is a name string; if it is interned,
+ * every search step is a pointer or a number comparison. Other keys
+ * should have their hash cached, or it is computed on every step.
  *
  * @param vector The vector to initialize.
  */
@@ -29,13 +35,19 @@ extern void vector_var_init (vector_var_t *vector);
  * They have a name, and an assotiated value and dictionary.
  * The value is really a list of values, and dictionary is
  * a name -> variable map.
+ *
+ * The value is a persistent vector of atoms, so it can be shared
+ * between variables (e.g. when expanding $A or passing arguments
+ * to a function block) without copying anything. Short values
+ * take just a small node, and the vector of fields doesn't allocate
+ * anything until it gets a field.
  */
 typedef struct
 {
-    /// The name of the variable
-    str_t name;
-    /// A list of word_t values
-    vector_atom_t value;
+    /// The name of the variable (interned)
+    const str_t *name;
+    /// A list of atom_t values (see pvector_atom_init())
+    pvector_t value;
     /// The variable fields
     vector_var_t fields;
     /// A pointer to parent variable (or NULL for root context)
@@ -46,8 +58,11 @@ typedef struct
  * Initialize a variable to empty state.
  *
  * @param var The variable to initialize.
+ * @param name Variable name. It is interned, so it's fine to pass
+ *     a temporary string here.
+ * @return false if not enough memory.
  */
-extern void var_init (var_t *var, str_t *name);
+extern bool var_init (var_t *var, const str_t *name);
 
 /**
  * Finalize a variable object.
@@ -63,6 +78,36 @@ extern void var_done (var_t *var);
  */
 extern void var_free (var_t *var);
 
+/**
+ * Assign a value to a variable. The value is shared, not copied.
+ *
+ * @param var The variable to assign to.
+ * @param value The new value (a vector of atoms).
+ */
+extern void var_set_value (var_t *var, const pvector_t *value);
+
+/**
+ * Append atoms to the variable value (the += operation).
+ * The atoms are shared, not copied.
+ *
+ * @param var The variable to modify.
+ * @param value The atoms to append.
+ * @return false on memory allocation failure.
+ */
+extern bool var_append_value (var_t *var, const pvector_t *value);
+
+/**
+ * Add a batch of fields to a variable. This is much faster than adding
+ * fields one by one, if there are many of them.
+ *
+ * @param var The variable to add fields to.
+ * @param fields A vector of var_t fields to add, in any order.
+ *     On success it becomes empty, see vector_insert_sorted_bulk().
+ * @param dup What to do with fields which have same name as existing ones.
+ * @return false on memory allocation failure or a rejected duplicate.
+ */
+extern bool var_fields_merge (var_t *var, vector_var_t *fields, vector_dup_t dup);
+
 // ---------- // ---------- // ---------- // ---------- // ---------- //
 
 /**
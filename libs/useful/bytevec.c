@@ -7,3 +7,169 @@
 
 #include "bytevec.h"
 
+#include <string.h>
+
+uint8_t *byte_vector_grow (byte_vector_t *bv, int size)
+{
+    if ((size <= 0) || !str_expand (bv, size))
+        return NULL;
+
+    uint8_t *data = (uint8_t *)bv->data + bv->size;
+    bv->size += size;
+    // keep the data zero-terminated, like all other strings
+    bv->data [bv->size] = '\0';
+    return data;
+}
+
+bool byte_vector_put (byte_vector_t *bv, const void *data, int size)
+{
+    if (size == 0)
+        return true;
+
+    uint8_t *dst = byte_vector_grow (bv, size);
+    if (!dst)
+        return false;
+
+    memcpy (dst, data, (size_t)size);
+    return true;
+}
+
+bool byte_vector_put_u8 (byte_vector_t *bv, uint8_t value)
+{
+    uint8_t *dst = byte_vector_grow (bv, 1);
+    if (!dst)
+        return false;
+
+    dst [0] = value;
+    return true;
+}
+
+bool byte_vector_put_u16 (byte_vector_t *bv, uint16_t value)
+{
+    uint8_t *dst = byte_vector_grow (bv, 2);
+    if (!dst)
+        return false;
+
+    dst [0] = (uint8_t)value;
+    dst [1] = (uint8_t)(value >> 8);
+    return true;
+}
+
+bool byte_vector_put_u32 (byte_vector_t *bv, uint32_t value)
+{
+    uint8_t *dst = byte_vector_grow (bv, 4);
+    if (!dst)
+        return false;
+
+    for (int i = 0; i < 4; i++, value >>= 8)
+        dst [i] = (uint8_t)value;
+    return true;
+}
+
+bool byte_vector_put_u64 (byte_vector_t *bv, uint64_t value)
+{
+    uint8_t *dst = byte_vector_grow (bv, 8);
+    if (!dst)
+        return false;
+
+    for (int i = 0; i < 8; i++, value >>= 8)
+        dst [i] = (uint8_t)value;
+    return true;
+}
+
+bool byte_vector_put_uvar (byte_vector_t *bv, uint64_t value)
+{
+    uint8_t temp [BYTE_VARINT_MAX];
+    int len = 0;
+
+    while (value >= 0x80)
+    {
+        temp [len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    temp [len++] = (uint8_t)value;
+
+    return byte_vector_put (bv, temp, len);
+}
+
+bool byte_vector_put_svar (byte_vector_t *bv, int64_t value)
+{
+    // zigzag: 0, -1, 1, -2, 2 ... -> 0, 1, 2, 3, 4 ...
+    return byte_vector_put_uvar (bv, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+bool byte_vector_put_blob (byte_vector_t *bv, const void *data, int size)
+{
+    if (size < 0)
+        return false;
+
+    int old_size = bv->size;
+    if (byte_vector_put_uvar (bv, (uint64_t)size) &&
+        byte_vector_put (bv, data, size))
+        return true;
+
+    // Don't leave a length without the data
+    if (bv->size > old_size)
+    {
+        bv->size = old_size;
+        bv->data [old_size] = '\0';
+    }
+    return false;
+}
+
+// ---------- // ---------- // ---------- // ---------- // ---------- //
+
+uint64_t byte_reader_uvar_slow (byte_reader_t *rd)
+{
+    uint64_t value = 0;
+    for (unsigned shift = 0; rd->cur < rd->end; shift += 7)
+    {
+        uint8_t byte = *rd->cur++;
+
+        // The 10th byte may contain just one significant bit
+        if ((shift == 63) && (byte > 1))
+            break;
+
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+
+    // Truncated or too long number
+    rd->error = true;
+    rd->cur = rd->end;
+    return 0;
+}
+
+const uint8_t *byte_reader_blob (byte_reader_t *rd, int *size)
+{
+    uint64_t len = byte_reader_uvar (rd);
+    const uint8_t *data = NULL;
+    if (!rd->error)
+    {
+        if (len <= (uint64_t)byte_reader_left (rd))
+            data = byte_reader_take (rd, (int)len);
+        else
+        {
+            rd->error = true;
+            rd->cur = rd->end;
+        }
+    }
+
+    *size = data ? (int)len : 0;
+    return data;
+}
+
+bool byte_reader_str (byte_reader_t *rd, str_t *str)
+{
+    int size;
+    const uint8_t *data = byte_reader_blob (rd, &size);
+    if (!data)
+    {
+        str_init (str);
+        return false;
+    }
+
+    str_init_c_const (str, (const char *)data, size);
+    return true;
+}
@@ -13,6 +13,16 @@
 /**
  * A dynamically-sized array of bytes.
  * This is based on the str class, but can contain zero bytes.
+ *
+ * The byte_vector_put_xxx() functions serialize data into the vector
+ * in a compact, machine-independent format:
+ * @li fixed-width integers are stored little-endian;
+ * @li variable-length integers use LEB128 encoding (7 bits per byte,
+ *     high bit set if more bytes follow), signed numbers are zigzag-encoded
+ *     first so that small negative numbers are short too;
+ * @li strings and blobs are prefixed with their length as a varint.
+ *
+ * The data is read back with a byte_reader_t.
  */
 typedef str_t byte_vector_t;
 
@@ -21,4 +31,305 @@ typedef str_t byte_vector_t;
 #define byte_vector_done str_done
 #define byte_vector_free str_free
 
+/// The maximal length of a LEB128-encoded 64-bit number
+#define BYTE_VARINT_MAX     10
+
+/**
+ * Append @a size uninitialized bytes to the end of the vector.
+ *
+ * @param bv The byte vector.
+ * @param size The number of bytes to append (must be positive).
+ * @return A pointer to the appended bytes, or NULL on memory
+ *      allocation failure.
+ */
+extern uint8_t *byte_vector_grow (byte_vector_t *bv, int size);
+
+/**
+ * Append raw bytes to the vector.
+ *
+ * @param bv The byte vector.
+ * @param data The bytes to append.
+ * @param size The number of bytes.
+ * @return false on memory allocation failure.
+ */
+extern bool byte_vector_put (byte_vector_t *bv, const void *data, int size);
+
+/**
+ * Append a byte to the vector.
+ *
+ * @param bv The byte vector.
+ * @param value The value to append.
+ * @return false on memory allocation failure.
+ */
+extern bool byte_vector_put_u8 (byte_vector_t *bv, uint8_t value);
+
+/**
+ * Append a 16-bit little-endian number to the vector.
+ *
+ * @param bv The byte vector.
+ * @param value The value to append.
+ * @return false on memory allocation failure.
+ */
+extern bool byte_vector_put_u16 (byte_vector_t *bv, uint16_t value);
+
+/**
+ * Append a 32-bit little-endian number to the vector.
+ *
+ * @param bv The byte vector.
+ * @param value The value to append.
+ * @return false on memory allocation failure.
+ */
+extern bool byte_vector_put_u32 (byte_vector_t *bv, uint32_t value);
+
+/**
+ * Append a 64-bit little-endian number to the vector.
+ *
+ * @param bv The byte vector.
+ * @param value The value to append.
+ * @return false on memory allocation failure.
+ */
+extern bool byte_vector_put_u64 (byte_vector_t *bv, uint64_t value);
+
+/**
+ * Append a unsigned LEB128 number to the vector.
+ *
+ * @param bv The byte vector.
+ * @param value The value to append.
+ * @return false on memory allocation failure.
+ */
+extern bool byte_vector_put_uvar (byte_vector_t *bv, uint64_t value);
+
+/**
+ * Append a signed (zigzag + LEB128) number to the vector.
+ *
+ * @param bv The byte vector.
+ * @param value The value to append.
+ * @return false on memory allocation failure.
+ */
+extern bool byte_vector_put_svar (byte_vector_t *bv, int64_t value);
+
+/**
+ * Append a length-prefixed blob to the vector.
+ * On failure the vector is left unchanged.
+ *
+ * @param bv The byte vector.
+ * @param data The blob data.
+ * @param size The blob size.
+ * @return false if size is negative or on memory allocation failure.
+ */
+extern bool byte_vector_put_blob (byte_vector_t *bv, const void *data, int size);
+
+/**
+ * Append a length-prefixed string to the vector.
+ *
+ * @param bv The byte vector.
+ * @param str The string to append.
+ * @return false on memory allocation failure.
+ */
+static inline bool byte_vector_put_str (byte_vector_t *bv, const str_t *str)
+{ return byte_vector_put_blob (bv, str->data, str->size); }
+
+// ---------- // ---------- // ---------- // ---------- // ---------- //
+
+/**
+ * A reader of data serialized with byte_vector_put_xxx().
+ *
+ * The reader never allocates memory and never copies the data,
+ * so it may be used directly over a file mapped with str_init_file().
+ * The source must live as long as the reader and anything read from it.
+ *
+ * Errors are sticky: reading past the end of data (or a malformed
+ * varint) sets the error flag and returns zeros from then on, so
+ * the caller may read a whole record and check byte_reader_ok() once.
+ */
+typedef struct
+{
+    /// Current read position
+    const uint8_t *cur;
+    /// The end of data
+    const uint8_t *end;
+    /// The start of data
+    const uint8_t *start;
+    /// true if a read failed
+    bool error;
+} byte_reader_t;
+
+/**
+ * Initialize a reader over a memory block.
+ *
+ * @param rd The reader to initialize.
+ * @param data The data to read.
+ * @param size Data size in bytes.
+ */
+static inline void byte_reader_init (byte_reader_t *rd, const void *data, int size)
+{
+    rd->start = rd->cur = data;
+    rd->end = rd->cur + (size > 0 ? size : 0);
+    rd->error = false;
+}
+
+/**
+ * Initialize a reader over the contents of a string or byte vector.
+ *
+ * @param rd The reader to initialize.
+ * @param str The string to read.
+ */
+static inline void byte_reader_init_str (byte_reader_t *rd, const str_t *str)
+{ byte_reader_init (rd, str->data, str->size); }
+
+/**
+ * Check if all reads so far were successful.
+ *
+ * @param rd The reader.
+ * @return false if there was an error.
+ */
+static inline bool byte_reader_ok (const byte_reader_t *rd)
+{ return !rd->error; }
+
+/**
+ * Get the number of bytes left to read.
+ *
+ * @param rd The reader.
+ * @return The number of unread bytes.
+ */
+static inline int byte_reader_left (const byte_reader_t *rd)
+{ return (int)(rd->end - rd->cur); }
+
+/**
+ * Get the current read position.
+ *
+ * @param rd The reader.
+ * @return The offset of next byte to read from the start of data.
+ */
+static inline int byte_reader_pos (const byte_reader_t *rd)
+{ return (int)(rd->cur - rd->start); }
+
+/**
+ * Take @a size bytes from the data.
+ *
+ * @param rd The reader.
+ * @param size The number of bytes to take.
+ * @return A pointer to the bytes, or NULL if there's not enough data
+ *      (in this case the error flag is set).
+ */
+static inline const uint8_t *byte_reader_take (byte_reader_t *rd, int size)
+{
+    if ((size < 0) || (size > rd->end - rd->cur))
+    {
+        rd->error = true;
+        rd->cur = rd->end;
+        return NULL;
+    }
+
+    const uint8_t *data = rd->cur;
+    rd->cur += size;
+    return data;
+}
+
+/**
+ * Read a byte.
+ *
+ * @param rd The reader.
+ * @return The value read (0 on error).
+ */
+static inline uint8_t byte_reader_u8 (byte_reader_t *rd)
+{
+    const uint8_t *p = byte_reader_take (rd, 1);
+    return p ? p [0] : 0;
+}
+
+/**
+ * Read a 16-bit little-endian number.
+ *
+ * @param rd The reader.
+ * @return The value read (0 on error).
+ */
+static inline uint16_t byte_reader_u16 (byte_reader_t *rd)
+{
+    const uint8_t *p = byte_reader_take (rd, 2);
+    return p ? (uint16_t)(p [0] | (p [1] << 8)) : 0;
+}
+
+/**
+ * Read a 32-bit little-endian number.
+ *
+ * @param rd The reader.
+ * @return The value read (0 on error).
+ */
+static inline uint32_t byte_reader_u32 (byte_reader_t *rd)
+{
+    const uint8_t *p = byte_reader_take (rd, 4);
+    return p ? (uint32_t)p [0] | ((uint32_t)p [1] << 8) |
+               ((uint32_t)p [2] << 16) | ((uint32_t)p [3] << 24) : 0;
+}
+
+/**
+ * Read a 64-bit little-endian number.
+ *
+ * @param rd The reader.
+ * @return The value read (0 on error).
+ */
+static inline uint64_t byte_reader_u64 (byte_reader_t *rd)
+{
+    uint64_t lo = byte_reader_u32 (rd);
+    uint64_t hi = byte_reader_u32 (rd);
+    return lo | (hi << 32);
+}
+
+/**
+ * Read a unsigned LEB128 number (the slow path, don't use directly).
+ *
+ * @param rd The reader.
+ * @return The value read (0 on error).
+ */
+extern uint64_t byte_reader_uvar_slow (byte_reader_t *rd);
+
+/**
+ * Read a unsigned LEB128 number.
+ *
+ * @param rd The reader.
+ * @return The value read (0 on error).
+ */
+static inline uint64_t byte_reader_uvar (byte_reader_t *rd)
+{
+    // Most numbers in practice are small
+    if ((rd->cur < rd->end) && !(rd->cur [0] & 0x80))
+        return *rd->cur++;
+    return byte_reader_uvar_slow (rd);
+}
+
+/**
+ * Read a signed (zigzag + LEB128) number.
+ *
+ * @param rd The reader.
+ * @return The value read (0 on error).
+ */
+static inline int64_t byte_reader_svar (byte_reader_t *rd)
+{
+    uint64_t value = byte_reader_uvar (rd);
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/**
+ * Read a length-prefixed blob.
+ *
+ * @param rd The reader.
+ * @param size Receives the blob size (0 on error).
+ * @return A pointer to the blob data in the source, or NULL on error.
+ *      An empty blob returns a non-NULL pointer.
+ */
+extern const uint8_t *byte_reader_blob (byte_reader_t *rd, int *size);
+
+/**
+ * Read a length-prefixed string. The string is a constant which refers
+ * to the reader source data, no memory is allocated. Since the text
+ * is not zero-terminated, use str->data and str->size to access it
+ * (or make a copy before calling str_c()).
+ *
+ * @param rd The reader.
+ * @param str The string to initialize (empty on error).
+ * @return false on error.
+ */
+extern bool byte_reader_str (byte_reader_t *rd, str_t *str);
+
 #endif /* __bytevec_H__ */
@@ -0,0 +1,193 @@
+/* The Cook project
+ * Byte class sets and fast scanning for characters in a set
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#include "charset.h"
+
+#include <string.h>
+#include <stdatomic.h>
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#define HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+/* A vectorized scanner. Returns the offset of the first byte for which
+ * "byte is in cs->list" equals @a want, or the number of bytes scanned
+ * without finding one (the caller checks the rest byte by byte).
+ */
+typedef size_t (*charset_scan_t) (const unsigned char *data, size_t size,
+                                  const charset_t *cs, bool want);
+
+static void charset_update (charset_t *cs)
+{
+    int members = 0;
+    for (int i = 0; i < 4; i++)
+        members += __builtin_popcountll (cs->bits [i]);
+
+    // List whatever is shorter: the members or the rest
+    cs->inverted = (members > 128);
+    cs->count = 0;
+
+    for (int c = 0; c < 256; c++)
+        if (charset_has (cs, (char)c) != cs->inverted)
+        {
+            if (cs->count >= CHARSET_LIST_MAX)
+            {
+                cs->count = -1;
+                break;
+            }
+            cs->list [cs->count++] = (unsigned char)c;
+        }
+}
+
+void charset_init (charset_t *cs, const char *chars)
+{
+    memset (cs->bits, 0, sizeof (cs->bits));
+    charset_add (cs, chars);
+}
+
+void charset_add_range (charset_t *cs, unsigned char first, unsigned char last)
+{
+    for (unsigned c = first; c <= last; c++)
+        cs->bits [c >> 6] |= 1ULL << (c & 63);
+
+    charset_update (cs);
+}
+
+void charset_add (charset_t *cs, const char *chars)
+{
+    if (chars)
+        for (; *chars; chars++)
+        {
+            unsigned char c = (unsigned char)*chars;
+            cs->bits [c >> 6] |= 1ULL << (c & 63);
+        }
+
+    charset_update (cs);
+}
+
+void charset_invert (charset_t *cs)
+{
+    for (int i = 0; i < 4; i++)
+        cs->bits [i] = ~cs->bits [i];
+
+    charset_update (cs);
+}
+
+// --------------------------------------------------------------- //
+
+static size_t charset_scan_scalar (const unsigned char *data, size_t size,
+                                   const charset_t *cs, bool want)
+{
+    // Leave everything to the caller
+    (void)data; (void)size; (void)cs; (void)want;
+    return 0;
+}
+
+#ifdef HAVE_X86_SIMD
+
+__attribute__ ((target ("sse2")))
+static size_t charset_scan_sse2 (const unsigned char *data, size_t size,
+                                 const charset_t *cs, bool want)
+{
+    __m128i list [CHARSET_LIST_MAX];
+    int count = cs->count;
+    for (int i = 0; i < count; i++)
+        list [i] = _mm_set1_epi8 ((char)cs->list [i]);
+
+    unsigned flip = want ? 0 : 0xffff;
+    size_t ofs;
+    for (ofs = 0; ofs + 16 <= size; ofs += 16)
+    {
+        __m128i block = _mm_loadu_si128 ((const __m128i *)(data + ofs));
+        __m128i match = _mm_setzero_si128 ();
+        for (int i = 0; i < count; i++)
+            match = _mm_or_si128 (match, _mm_cmpeq_epi8 (block, list [i]));
+
+        unsigned mask = (unsigned)_mm_movemask_epi8 (match) ^ flip;
+        if (mask)
+            return ofs + (size_t)__builtin_ctz (mask);
+    }
+
+    return ofs;
+}
+
+__attribute__ ((target ("avx2")))
+static size_t charset_scan_avx2 (const unsigned char *data, size_t size,
+                                 const charset_t *cs, bool want)
+{
+    __m256i list [CHARSET_LIST_MAX];
+    int count = cs->count;
+    for (int i = 0; i < count; i++)
+        list [i] = _mm256_set1_epi8 ((char)cs->list [i]);
+
+    unsigned flip = want ? 0 : 0xffffffff;
+    size_t ofs;
+    for (ofs = 0; ofs + 32 <= size; ofs += 32)
+    {
+        __m256i block = _mm256_loadu_si256 ((const __m256i *)(data + ofs));
+        __m256i match = _mm256_setzero_si256 ();
+        for (int i = 0; i < count; i++)
+            match = _mm256_or_si256 (match, _mm256_cmpeq_epi8 (block, list [i]));
+
+        unsigned mask = (unsigned)_mm256_movemask_epi8 (match) ^ flip;
+        if (mask)
+            return ofs + (size_t)__builtin_ctz (mask);
+    }
+
+    return ofs;
+}
+
+#endif
+
+static charset_scan_t charset_select ()
+{
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init ();
+    if (__builtin_cpu_supports ("avx2"))
+        return charset_scan_avx2;
+    if (__builtin_cpu_supports ("sse2"))
+        return charset_scan_sse2;
+#endif
+    return charset_scan_scalar;
+}
+
+// The best scanner for this CPU, selected on first use
+static _Atomic (charset_scan_t) charset_scan = NULL;
+
+static inline size_t charset_scan_fast (const char *data, size_t size,
+                                        const charset_t *cs, bool want)
+{
+    // Not worth the setup for short runs
+    if ((cs->count < 0) || (size < 16))
+        return 0;
+
+    charset_scan_t scan = atomic_load_explicit (&charset_scan, memory_order_relaxed);
+    if (!scan)
+    {
+        scan = charset_select ();
+        atomic_store_explicit (&charset_scan, scan, memory_order_relaxed);
+    }
+
+    return scan ((const unsigned char *)data, size, cs, want);
+}
+
+size_t mem_span (const char *data, size_t size, const charset_t *cs)
+{
+    size_t ofs = charset_scan_fast (data, size, cs, cs->inverted);
+    while ((ofs < size) && charset_has (cs, data [ofs]))
+        ofs++;
+    return ofs;
+}
+
+size_t mem_find_any (const char *data, size_t size, const charset_t *cs)
+{
+    size_t ofs = charset_scan_fast (data, size, cs, !cs->inverted);
+    while ((ofs < size) && !charset_has (cs, data [ofs]))
+        ofs++;
+    return ofs;
+}
@@ -0,0 +1,130 @@
+/* The Cook project
+ * Byte class sets and fast scanning for characters in a set
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#ifndef __CHARSET_H__
+#define __CHARSET_H__
+
+#include "str.h"
+
+/// Sets with at most this many members (or non-members) are scanned with SIMD
+#define CHARSET_LIST_MAX    16
+
+/**
+ * A set of byte values (character class).
+ *
+ * Besides the bitmap, which is used to check single characters,
+ * the set keeps a short list of its members, or of non-members
+ * if the set is large. The list lets the scanning functions compare
+ * 16 or 32 bytes at a time against every listed character, so sets
+ * like "all spaces" or "anything but stop characters" are scanned
+ * at memory bandwidth. Sets with more than CHARSET_LIST_MAX members
+ * and non-members at the same time are scanned byte by byte.
+ *
+ * Sets are meant to be built once and used many times: every function
+ * modifying the set rebuilds the list.
+ */
+typedef struct
+{
+    /// One bit for every byte value
+    uint64_t bits [4];
+    /// Number of characters in list, or -1 if the set is not listable
+    int count;
+    /// true if list contains the characters NOT in the set
+    bool inverted;
+    /// Set members (or non-members if inverted)
+    unsigned char list [CHARSET_LIST_MAX];
+} charset_t;
+
+/**
+ * Initialize a character set from a list of characters.
+ *
+ * @param cs The character set to initialize.
+ * @param chars Set members (may be NULL for an empty set).
+ */
+extern void charset_init (charset_t *cs, const char *chars);
+
+/**
+ * Add a range of characters to the set.
+ *
+ * @param cs The character set to modify.
+ * @param first First character in the range.
+ * @param last Last character in the range (inclusive).
+ */
+extern void charset_add_range (charset_t *cs, unsigned char first, unsigned char last);
+
+/**
+ * Add characters to the set.
+ *
+ * @param cs The character set to modify.
+ * @param chars A zero-terminated list of characters to add.
+ */
+extern void charset_add (charset_t *cs, const char *chars);
+
+/**
+ * Replace the set with its complement.
+ *
+ * @param cs The character set to modify.
+ */
+extern void charset_invert (charset_t *cs);
+
+/**
+ * Check if a character belongs to the set.
+ *
+ * @param cs The character set.
+ * @param c The character to check.
+ * @return true if c is in the set.
+ */
+static inline bool charset_has (const charset_t *cs, char c)
+{
+    unsigned char uc = (unsigned char)c;
+    return (cs->bits [uc >> 6] >> (uc & 63)) & 1;
+}
+
+/**
+ * Find the length of the initial segment of memory block
+ * which consists only of characters from the set.
+ *
+ * @param data The data to scan.
+ * @param size Data size in bytes.
+ * @param cs The character set.
+ * @return Offset of the first character not in set, or size.
+ */
+extern size_t mem_span (const char *data, size_t size, const charset_t *cs);
+
+/**
+ * Find the first character from the set in a memory block.
+ *
+ * @param data The data to scan.
+ * @param size Data size in bytes.
+ * @param cs The character set.
+ * @return Offset of the first character in set, or size if not found.
+ */
+extern size_t mem_find_any (const char *data, size_t size, const charset_t *cs);
+
+/**
+ * Skip characters from the set, starting at given position in a string.
+ *
+ * @param str The string to scan.
+ * @param pos Starting position.
+ * @param cs The character set.
+ * @return Position of the first character not in set, or string size.
+ */
+static inline int str_span (const str_t *str, int pos, const charset_t *cs)
+{ return pos + (int)mem_span (str->data + pos, (size_t)(str->size - pos), cs); }
+
+/**
+ * Find the first character from the set, starting at given position in a string.
+ *
+ * @param str The string to scan.
+ * @param pos Starting position.
+ * @param cs The character set.
+ * @return Position of the first character in set, or string size if not found.
+ */
+static inline int str_find_any (const str_t *str, int pos, const charset_t *cs)
+{ return pos + (int)mem_find_any (str->data + pos, (size_t)(str->size - pos), cs); }
+
+#endif /* __CHARSET_H__ */
@@ -0,0 +1,260 @@
+/* The Cook project
+ * Open addressing hash map with Robin Hood probing
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#include "hashmap.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+// Never allocate less slots than this
+#define HASHMAP_MIN_SLOTS   16
+
+/* The maximal number of elements for given number of slots.
+ * Robin Hood hashing works well up to ~90% load, we stop at 80%.
+ */
+static inline int hashmap_capacity (unsigned slots)
+{
+    return (int)(slots - slots / 5);
+}
+
+static inline const void *hashmap_key (const hashmap_t *map, const void *item)
+{
+    return map->vmt->key ? map->vmt->key (item) : item;
+}
+
+// How far the slot is from the home slot of its element
+static inline unsigned hashmap_dist (const hashmap_t *map, unsigned idx)
+{
+    return (idx - (unsigned)map->slots [idx].hash) & map->mask;
+}
+
+void hashmap_init (hashmap_t *map, const hashmap_vmt_t *vmt, int size)
+{
+    assert (map && vmt && vmt->hash && vmt->equal);
+
+    memset (map, 0, sizeof (*map));
+    map->vmt = vmt;
+    hashmap_reserve (map, size);
+}
+
+void hashmap_clear (hashmap_t *map)
+{
+    assert (map);
+
+    if (!map->slots)
+        return;
+
+    if (map->vmt->free)
+        for (unsigned i = 0; i <= map->mask; i++)
+            if (map->slots [i].item)
+                map->vmt->free (map->slots [i].item);
+
+    memset (map->slots, 0, (map->mask + 1) * sizeof (hashmap_slot_t));
+    map->size = 0;
+}
+
+void hashmap_done (hashmap_t *map)
+{
+    assert (map);
+
+    hashmap_clear (map);
+    free (map->slots);
+    map->slots = NULL;
+    map->mask = 0;
+}
+
+/* Put a element which is known to be absent from the map
+ * into the table, moving other elements as needed.
+ */
+static void hashmap_place (hashmap_t *map, void *item, uint64_t hash)
+{
+    unsigned idx = (unsigned)hash & map->mask;
+    unsigned dist = 0;
+
+    for (;;)
+    {
+        hashmap_slot_t *slot = &map->slots [idx];
+        if (!slot->item)
+        {
+            slot->item = item;
+            slot->hash = hash;
+            return;
+        }
+
+        // Rob the rich: the current element is closer to its home
+        unsigned slot_dist = hashmap_dist (map, idx);
+        if (slot_dist < dist)
+        {
+            hashmap_slot_t tmp = *slot;
+            slot->item = item;
+            slot->hash = hash;
+            item = tmp.item;
+            hash = tmp.hash;
+            dist = slot_dist;
+        }
+
+        idx = (idx + 1) & map->mask;
+        dist++;
+    }
+}
+
+static bool hashmap_resize (hashmap_t *map, unsigned slots)
+{
+    hashmap_slot_t *new_slots = calloc (slots, sizeof (hashmap_slot_t));
+    if (!new_slots)
+        return false;
+
+    hashmap_slot_t *old_slots = map->slots;
+    unsigned old_count = map->slots ? map->mask + 1 : 0;
+
+    map->slots = new_slots;
+    map->mask = slots - 1;
+
+    for (unsigned i = 0; i < old_count; i++)
+        if (old_slots [i].item)
+            hashmap_place (map, old_slots [i].item, old_slots [i].hash);
+
+    free (old_slots);
+    return true;
+}
+
+bool hashmap_reserve (hashmap_t *map, int size)
+{
+    assert (map);
+
+    unsigned slots = map->slots ? map->mask + 1 : 0;
+    if (size <= (slots ? hashmap_capacity (slots) : 0))
+        return true;
+
+    if (!slots)
+        slots = HASHMAP_MIN_SLOTS;
+    while (hashmap_capacity (slots) < size)
+        slots *= 2;
+
+    return hashmap_resize (map, slots);
+}
+
+/* Find the slot containing the element with given key.
+ * Returns -1 if there's no such element.
+ */
+static int hashmap_find (const hashmap_t *map, const void *key, uint64_t hash)
+{
+    if (!map->slots)
+        return -1;
+
+    unsigned idx = (unsigned)hash & map->mask;
+    for (unsigned dist = 0; ; dist++)
+    {
+        const hashmap_slot_t *slot = &map->slots [idx];
+
+        // If we'd own this slot, the element would be here
+        if (!slot->item || (hashmap_dist (map, idx) < dist))
+            return -1;
+
+        if ((slot->hash == hash) &&
+            map->vmt->equal (hashmap_key (map, slot->item), key))
+            return (int)idx;
+
+        idx = (idx + 1) & map->mask;
+    }
+}
+
+void *hashmap_get (const hashmap_t *map, const void *key)
+{
+    assert (map);
+
+    if (!map->size)
+        return NULL;
+
+    int idx = hashmap_find (map, key, map->vmt->hash (key));
+    return (idx >= 0) ? map->slots [idx].item : NULL;
+}
+
+bool hashmap_set (hashmap_t *map, void *item)
+{
+    assert (map && item);
+
+    uint64_t hash = map->vmt->hash (hashmap_key (map, item));
+
+    int idx = hashmap_find (map, hashmap_key (map, item), hash);
+    if (idx >= 0)
+    {
+        void *old = map->slots [idx].item;
+        map->slots [idx].item = item;
+        if ((old != item) && map->vmt->free)
+            map->vmt->free (old);
+        return true;
+    }
+
+    if (!hashmap_reserve (map, map->size + 1))
+        return false;
+
+    hashmap_place (map, item, hash);
+    map->size++;
+    return true;
+}
+
+void *hashmap_take (hashmap_t *map, const void *key)
+{
+    assert (map);
+
+    if (!map->size)
+        return NULL;
+
+    int found = hashmap_find (map, key, map->vmt->hash (key));
+    if (found < 0)
+        return NULL;
+
+    unsigned idx = (unsigned)found;
+    void *item = map->slots [idx].item;
+
+    // Shift following elements back, so that there are no holes in chains
+    for (;;)
+    {
+        unsigned next = (idx + 1) & map->mask;
+        if (!map->slots [next].item || (hashmap_dist (map, next) == 0))
+            break;
+
+        map->slots [idx] = map->slots [next];
+        idx = next;
+    }
+
+    map->slots [idx].item = NULL;
+    map->slots [idx].hash = 0;
+    map->size--;
+
+    return item;
+}
+
+bool hashmap_delete (hashmap_t *map, const void *key)
+{
+    void *item = hashmap_take (map, key);
+    if (!item)
+        return false;
+
+    if (map->vmt->free)
+        map->vmt->free (item);
+    return true;
+}
+
+void *hashmap_next (const hashmap_t *map, int *pos)
+{
+    assert (map && pos);
+
+    if (!map->slots)
+        return NULL;
+
+    while ((unsigned)*pos <= map->mask)
+    {
+        void *item = map->slots [(*pos)++].item;
+        if (item)
+            return item;
+    }
+
+    return NULL;
+}
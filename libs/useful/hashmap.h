@@ -0,0 +1,175 @@
+/* The Cook project
+ * Open addressing hash map with Robin Hood probing
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#ifndef __HASHMAP_H__
+#define __HASHMAP_H__
+
+#include "useful.h"
+
+/**
+ * This table contains pointers to functions which tell the hash map
+ * how to handle its items. Every item contains its own key, which
+ * is extracted with the key() method.
+ */
+typedef struct
+{
+    /**
+     * Free a element of the hash map (may be NULL).
+     * @param item The element to free.
+     */
+    void (*free) (void *item);
+
+    /**
+     * Get the key of a element (may be NULL if the element is the key).
+     * @param item The element of the hash map.
+     * @return The key of the element.
+     */
+    const void *(*key) (const void *item);
+
+    /**
+     * Compute the hash of a key.
+     * @param key The key to hash.
+     * @return The hash value.
+     */
+    uint64_t (*hash) (const void *key);
+
+    /**
+     * Compare two keys for equality.
+     * @param key1 The first key.
+     * @param key2 The second key.
+     * @return true if keys are equal.
+     */
+    bool (*equal) (const void *key1, const void *key2);
+} hashmap_vmt_t;
+
+/// A single hash map slot
+typedef struct
+{
+    /// The element, NULL if slot is empty
+    void *item;
+    /// The full hash of element key
+    uint64_t hash;
+} hashmap_slot_t;
+
+/**
+ * A hash table of pointers to any types of objects, keyed by some
+ * part of the object itself.
+ *
+ * Collisions are resolved with linear probing, using the Robin Hood
+ * rule: elements which are far from their home slot take the place
+ * of elements which are closer to theirs. This keeps all probe sequences
+ * short even when the table is filled up to 80%, so the elements are
+ * stored in a single flat array and lookups rarely touch more than
+ * one cache line. Full hashes are stored next to the pointers, so
+ * the table grows without calling hash() again, and the equal() method
+ * is called only for elements which have a matching hash.
+ */
+typedef struct
+{
+    /// Virtual method table
+    const hashmap_vmt_t *vmt;
+    /// Array of slots
+    hashmap_slot_t *slots;
+    /// Number of slots minus one (the number of slots is a power of two)
+    unsigned mask;
+    /// Number of elements in the table
+    int size;
+} hashmap_t;
+
+/**
+ * Initialize a empty hash map, given an estimate of its size.
+ * When done, free it with hashmap_done().
+ *
+ * @param map The hash map to initialize.
+ * @param vmt The virtual method table (must stay valid while map is in use).
+ * @param size Estimated number of elements in the hash map.
+ *     Can be 0 in which case the map will grow as needed.
+ */
+extern void hashmap_init (hashmap_t *map, const hashmap_vmt_t *vmt, int size);
+
+/**
+ * Free all the elements of the hash map.
+ * The memory used by the table is not freed.
+ *
+ * @param map The hash map to clear.
+ */
+extern void hashmap_clear (hashmap_t *map);
+
+/**
+ * Free all the elements and all memory used by the hash map.
+ *
+ * @param map The hash map to finalize.
+ */
+extern void hashmap_done (hashmap_t *map);
+
+/**
+ * Make sure the hash map may hold @a size elements without growing.
+ *
+ * @param map The hash map.
+ * @param size Desired number of elements.
+ * @return false on memory allocation failure.
+ */
+extern bool hashmap_reserve (hashmap_t *map, int size);
+
+/**
+ * Find a element by its key.
+ *
+ * @param map The hash map to search.
+ * @param key The key to look for.
+ * @return The element or NULL if not found.
+ */
+extern void *hashmap_get (const hashmap_t *map, const void *key);
+
+/**
+ * Add a element to the hash map. If the map already contains
+ * a element with same key, it is freed and replaced with the new one.
+ *
+ * @param map The hash map.
+ * @param item The element to add (must not be NULL).
+ * @return false on memory allocation failure (the item is not added).
+ */
+extern bool hashmap_set (hashmap_t *map, void *item);
+
+/**
+ * Remove a element from the hash map without freeing it.
+ *
+ * @param map The hash map.
+ * @param key The key of element to remove.
+ * @return The removed element or NULL if not found.
+ */
+extern void *hashmap_take (hashmap_t *map, const void *key);
+
+/**
+ * Remove a element from the hash map and free it.
+ *
+ * @param map The hash map.
+ * @param key The key of element to remove.
+ * @return false if there was no such element.
+ */
+extern bool hashmap_delete (hashmap_t *map, const void *key);
+
+/**
+ * Iterate over all elements of the hash map, in no particular order.
+ * The map must not be modified during the iteration.
+ * Usage: for (int pos = 0; (item = hashmap_next (map, &pos)); ) ...
+ *
+ * @param map The hash map.
+ * @param pos Iterator state, set to 0 before the first call.
+ * @return Next element or NULL if there are no more elements.
+ */
+extern void *hashmap_next (const hashmap_t *map, int *pos);
+
+/**
+ * Get the number of elements in the hash map.
+ *
+ * @param map The hash map.
+ * @return The number of elements.
+ */
+static inline int hashmap_size (const hashmap_t *map)
+{ return map->size; }
+
+#endif /* __HASHMAP_H__ */
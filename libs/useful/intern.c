@@ -0,0 +1,148 @@
+/* The Cook project
+ * String interning (a global table of unique symbols)
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#include "intern.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+/* A interned string. The text is allocated together with the
+ * str_t object, which refers to it as to a constant. The string
+ * hash is always precomputed, so str_equal() on interned strings
+ * never has to look at the text.
+ */
+typedef struct
+{
+    /// The string object handed out to the users
+    str_t str;
+    /// The zero-terminated text follows
+    char text [];
+} intern_t;
+
+/* The symbol table is a open addressing hash table with linear probing.
+ * It is kept no more than half full, so probe sequences stay short.
+ */
+static intern_t **intern_table = NULL;
+static unsigned intern_mask = 0;
+static unsigned intern_count = 0;
+
+// Symbols are usually added from a single thread, so a spinlock is enough
+static atomic_flag intern_lock = ATOMIC_FLAG_INIT;
+
+static inline void intern_acquire ()
+{
+    while (atomic_flag_test_and_set_explicit (&intern_lock, memory_order_acquire))
+        ;
+}
+
+static inline void intern_release ()
+{
+    atomic_flag_clear_explicit (&intern_lock, memory_order_release);
+}
+
+static bool intern_grow ()
+{
+    unsigned new_size = intern_table ? (intern_mask + 1) * 2 : 256;
+    intern_t **new_table = calloc (new_size, sizeof (intern_t *));
+    if (!new_table)
+        return false;
+
+    if (intern_table)
+    {
+        for (unsigned i = 0; i <= intern_mask; i++)
+        {
+            intern_t *sym = intern_table [i];
+            if (!sym)
+                continue;
+
+            unsigned idx = (unsigned)sym->str.hash & (new_size - 1);
+            while (new_table [idx])
+                idx = (idx + 1) & (new_size - 1);
+            new_table [idx] = sym;
+        }
+
+        free (intern_table);
+    }
+
+    intern_table = new_table;
+    intern_mask = new_size - 1;
+    return true;
+}
+
+static const str_t *intern (const char *cstr, int size, uint64_t hash)
+{
+    intern_t *sym = NULL;
+
+    intern_acquire ();
+
+    if ((intern_count + 1) * 2 > intern_mask + 1)
+        if (!intern_grow ())
+            goto leave;
+
+    unsigned idx = (unsigned)hash & intern_mask;
+    while ((sym = intern_table [idx]) != NULL)
+    {
+        if ((sym->str.hash == hash) && (sym->str.size == size) &&
+            (memcmp (sym->text, cstr, (size_t)size) == 0))
+            goto leave;
+
+        idx = (idx + 1) & intern_mask;
+    }
+
+    // Not found, add a new symbol
+    sym = malloc (sizeof (intern_t) + (size_t)size + 1);
+    if (!sym)
+        goto leave;
+
+    memcpy (sym->text, cstr, (size_t)size);
+    sym->text [size] = '\0';
+    str_init_c_const (&sym->str, sym->text, size);
+    sym->str.hash = hash;
+
+    intern_table [idx] = sym;
+    intern_count++;
+
+leave:
+    intern_release ();
+    return sym ? &sym->str : NULL;
+}
+
+const str_t *str_intern_c (const char *cstr, int size)
+{
+    if (!cstr)
+        cstr = "";
+    if (size < 0)
+        size = (int)strlen (cstr);
+
+    return intern (cstr, size, str_hash_c (cstr, size));
+}
+
+const str_t *str_intern (const str_t *str)
+{
+    // Use the cached hash, if it's there
+    uint64_t hash = str->hash ? str->hash : str_hash_c (str->data, str->size);
+    return intern (str->data, str->size, hash);
+}
+
+void str_intern_finalize ()
+{
+    intern_acquire ();
+
+    if (intern_table)
+    {
+        for (unsigned i = 0; i <= intern_mask; i++)
+            free (intern_table [i]);
+
+        free (intern_table);
+        intern_table = NULL;
+    }
+
+    intern_mask = intern_count = 0;
+
+    intern_release ();
+}
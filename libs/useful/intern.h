@@ -0,0 +1,46 @@
+/* The Cook project
+ * String interning (a global table of unique symbols)
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#ifndef __INTERN_H__
+#define __INTERN_H__
+
+#include "str.h"
+
+/**
+ * Get the canonical (interned) copy of a string.
+ *
+ * Equal strings always get same handle, so interned strings
+ * may be compared just by comparing pointers, and every distinct
+ * string is stored just once no matter how many times it's used.
+ *
+ * The returned string is a constant which stays valid until
+ * str_intern_finalize() is called. It may be safely shared with
+ * str_set(), this won't allocate anything.
+ *
+ * The function is thread-safe.
+ *
+ * @param str The string to intern.
+ * @return The interned string or NULL if not enough memory.
+ */
+extern const str_t *str_intern (const str_t *str);
+
+/**
+ * Get the canonical (interned) copy of a C string.
+ *
+ * @param cstr A pointer to the C string.
+ * @param size String size in bytes or -1 to use strlen()
+ * @return The interned string or NULL if not enough memory.
+ */
+extern const str_t *str_intern_c (const char *cstr, int size);
+
+/**
+ * Free all interned strings. All handles returned by str_intern()
+ * become invalid. This is called automatically by str_finalize().
+ */
+extern void str_intern_finalize (void);
+
+#endif /* __INTERN_H__ */
@@ -0,0 +1,309 @@
+/* The Cook project
+ * Persistent (structurally shared) vectors
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#include "pvector.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdatomic.h>
+
+#define PVECTOR_MASK        (PVECTOR_WIDTH - 1)
+
+/* A tree node. Leaf nodes contain elements, inner nodes contain
+ * pointers to other nodes; NULL slots are empty. All nodes have
+ * PVECTOR_WIDTH slots, except the root node of a small vector,
+ * which is a leaf growing as needed.
+ */
+struct _pvector_node_t
+{
+    /// Number of vectors and nodes referring to this node
+    atomic_int refcnt;
+    /// Number of slots in this node
+    int capacity;
+    /// Elements or child nodes
+    void *slots [];
+};
+
+static pvector_node_t *pvector_node_new (int capacity)
+{
+    pvector_node_t *node = calloc (1, sizeof (pvector_node_t) +
+                                   (size_t)capacity * sizeof (void *));
+    if (!node)
+        return NULL;
+
+    atomic_init (&node->refcnt, 1);
+    node->capacity = capacity;
+    return node;
+}
+
+static inline void pvector_node_incref (pvector_node_t *node)
+{
+    if (node)
+        atomic_fetch_add_explicit (&node->refcnt, 1, memory_order_relaxed);
+}
+
+static void pvector_node_decref (const pvector_t *vec, pvector_node_t *node, int shift)
+{
+    if (!node)
+        return;
+
+    if (atomic_fetch_sub_explicit (&node->refcnt, 1, memory_order_acq_rel) != 1)
+        return;
+
+    for (int i = 0; i < node->capacity; i++)
+    {
+        if (!node->slots [i])
+            continue;
+
+        if (shift)
+            pvector_node_decref (vec, node->slots [i], shift - PVECTOR_BITS);
+        else if (vec->vmt && vec->vmt->release)
+            vec->vmt->release (node->slots [i]);
+    }
+
+    free (node);
+}
+
+/* Make sure the node is not shared and has at least @a capacity slots.
+ * A shared node is replaced with a copy, which shares all the node
+ * contents with the original.
+ */
+static pvector_node_t *pvector_node_unshare (const pvector_t *vec,
+    pvector_node_t **pnode, int shift, int capacity)
+{
+    pvector_node_t *node = *pnode;
+    bool shared = (atomic_load_explicit (&node->refcnt, memory_order_acquire) != 1);
+    if (!shared && (node->capacity >= capacity))
+        return node;
+
+    // Small leaves grow geometrically
+    if (capacity < node->capacity * 2)
+        capacity = node->capacity * 2;
+    if (capacity > PVECTOR_WIDTH)
+        capacity = PVECTOR_WIDTH;
+
+    pvector_node_t *copy = pvector_node_new (capacity);
+    if (!copy)
+        return NULL;
+
+    memcpy (copy->slots, node->slots, (size_t)node->capacity * sizeof (void *));
+
+    if (shared)
+    {
+        // The copy is one more owner of everything in the node
+        for (int i = 0; i < node->capacity; i++)
+        {
+            if (!node->slots [i])
+                continue;
+
+            if (shift)
+                pvector_node_incref (node->slots [i]);
+            else if (vec->vmt && vec->vmt->retain)
+                vec->vmt->retain (node->slots [i]);
+        }
+
+        pvector_node_decref (vec, node, shift);
+    }
+    else
+        free (node);
+
+    *pnode = copy;
+    return copy;
+}
+
+/* Store a element at given tree index, copying shared nodes on the way.
+ */
+static bool pvector_store (pvector_t *vec, int idx, void *item)
+{
+    // Add levels on top of the tree until the index fits
+    while ((uint64_t)idx >= ((uint64_t)PVECTOR_WIDTH << vec->shift))
+    {
+        // Only full nodes may go down the tree
+        if (vec->root && !pvector_node_unshare (vec, &vec->root, vec->shift, PVECTOR_WIDTH))
+            return false;
+
+        pvector_node_t *root = pvector_node_new (PVECTOR_WIDTH);
+        if (!root)
+            return false;
+
+        root->slots [0] = vec->root;
+        vec->root = root;
+        vec->shift += PVECTOR_BITS;
+    }
+
+    pvector_node_t **pnode = &vec->root;
+    for (int shift = vec->shift; ; shift -= PVECTOR_BITS)
+    {
+        int slot = (idx >> shift) & PVECTOR_MASK;
+        // A root leaf grows as needed, all other nodes are full-sized
+        int capacity = (!shift && (pnode == &vec->root)) ? slot + 1 : PVECTOR_WIDTH;
+
+        pvector_node_t *node = *pnode;
+        if (!node)
+            node = *pnode = pvector_node_new (capacity);
+        else
+            node = pvector_node_unshare (vec, pnode, shift, capacity);
+        if (!node)
+            return false;
+
+        if (!shift)
+        {
+            // The slot may contain a element left beyond the end of a slice
+            if (node->slots [slot] && vec->vmt && vec->vmt->release)
+                vec->vmt->release (node->slots [slot]);
+            node->slots [slot] = item;
+            return true;
+        }
+
+        pnode = (pvector_node_t **)&node->slots [slot];
+    }
+}
+
+// Find the leaf node containing the element at given tree index
+static pvector_node_t *pvector_leaf (const pvector_t *vec, int idx)
+{
+    pvector_node_t *node = vec->root;
+    for (int shift = vec->shift; node && shift; shift -= PVECTOR_BITS)
+        node = node->slots [(idx >> shift) & PVECTOR_MASK];
+    return node;
+}
+
+// --------------------------------------------------------------- //
+
+void pvector_init (pvector_t *vec, const pvector_vmt_t *vmt)
+{
+    assert (vec);
+
+    memset (vec, 0, sizeof (*vec));
+    vec->vmt = vmt;
+}
+
+void pvector_init_copy (pvector_t *vec, const pvector_t *src)
+{
+    assert (vec && src);
+
+    *vec = *src;
+    pvector_node_incref (vec->root);
+}
+
+void pvector_init_slice (pvector_t *vec, const pvector_t *src, int pos, int size)
+{
+    assert (vec && src);
+
+    if (pos < 0)
+        pos = 0;
+    if (pos > src->size)
+        pos = src->size;
+    if ((size < 0) || (size > src->size - pos))
+        size = src->size - pos;
+
+    pvector_init_copy (vec, src);
+    vec->start += pos;
+    vec->size = size;
+}
+
+void pvector_done (pvector_t *vec)
+{
+    assert (vec);
+
+    pvector_node_decref (vec, vec->root, vec->shift);
+    vec->root = NULL;
+    vec->shift = vec->start = vec->size = 0;
+}
+
+void pvector_set (pvector_t *to, const pvector_t *from)
+{
+    if (to == from)
+        return;
+
+    // from may be a part of what to refers to, so grab it first
+    pvector_node_incref (from->root);
+    pvector_done (to);
+    *to = *from;
+}
+
+void *pvector_get (const pvector_t *vec, int pos)
+{
+    assert (vec);
+
+    if ((pos < 0) || (pos >= vec->size))
+        return NULL;
+
+    int idx = vec->start + pos;
+    return pvector_leaf (vec, idx)->slots [idx & PVECTOR_MASK];
+}
+
+int pvector_chunk (const pvector_t *vec, int pos, void ***items)
+{
+    assert (vec && items);
+
+    if ((pos < 0) || (pos >= vec->size))
+    {
+        *items = NULL;
+        return 0;
+    }
+
+    int idx = vec->start + pos;
+    int slot = idx & PVECTOR_MASK;
+    *items = pvector_leaf (vec, idx)->slots + slot;
+    return imin (PVECTOR_WIDTH - slot, vec->size - pos);
+}
+
+bool pvector_replace (pvector_t *vec, int pos, void *item)
+{
+    assert (vec && item);
+
+    if ((pos < 0) || (pos >= vec->size))
+        return false;
+
+    return pvector_store (vec, vec->start + pos, item);
+}
+
+bool pvector_append (pvector_t *vec, void *item)
+{
+    assert (vec && item);
+
+    if (!pvector_store (vec, vec->start + vec->size, item))
+        return false;
+
+    vec->size++;
+    return true;
+}
+
+bool pvector_join (pvector_t *vec, const pvector_t *tail)
+{
+    assert (vec && tail);
+
+    // Appending a vector to itself is fine since we iterate over a copy
+    pvector_t src;
+    pvector_init_copy (&src, tail);
+
+    bool ok = true;
+    for (int pos = 0; ok && (pos < src.size); )
+    {
+        void **items;
+        int count = pvector_chunk (&src, pos, &items);
+        for (int i = 0; i < count; i++)
+        {
+            if (src.vmt && src.vmt->retain)
+                src.vmt->retain (items [i]);
+
+            if (!pvector_append (vec, items [i]))
+            {
+                if (src.vmt && src.vmt->release)
+                    src.vmt->release (items [i]);
+                ok = false;
+                break;
+            }
+        }
+        pos += count;
+    }
+
+    pvector_done (&src);
+    return ok;
+}
@@ -0,0 +1,178 @@
+/* The Cook project
+ * Persistent (structurally shared) vectors
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#ifndef __PVECTOR_H__
+#define __PVECTOR_H__
+
+#include "useful.h"
+
+/// Number of bits of element index used at every tree level
+#define PVECTOR_BITS        5
+/// Number of children of every tree node
+#define PVECTOR_WIDTH       (1 << PVECTOR_BITS)
+
+/**
+ * This table tells the persistent vector how to share its elements.
+ * Elements are shared between vectors, so they must be reference-counted
+ * (or immortal, in which case both methods may be NULL).
+ */
+typedef struct
+{
+    /**
+     * Add a reference to the element.
+     * @param item The element which gets one more owner.
+     */
+    void (*retain) (void *item);
+
+    /**
+     * Drop a reference to the element.
+     * @param item The element which lost one owner.
+     */
+    void (*release) (void *item);
+} pvector_vmt_t;
+
+typedef struct _pvector_node_t pvector_node_t;
+
+/**
+ * A persistent vector of pointers to arbitrary (non-NULL) objects.
+ *
+ * Elements are kept in a tree of 32-way nodes, which is shallow enough
+ * to make element access practically O(1). Nodes are reference-counted
+ * and shared between vectors, so copying a vector or taking a slice of it
+ * is O(1), no matter how many elements it contains. Modifying a vector
+ * copies only the nodes on the path to the modified element, and only
+ * if they are shared; unshared nodes are modified in place, so appending
+ * elements to a vector nobody else refers to is as cheap as with vector_t.
+ *
+ * Like str_t, the pvector_t object itself is a handle which may be
+ * copied only with pvector_init_copy() or pvector_set(). Note that
+ * a slice keeps alive the whole tree it was taken from.
+ */
+typedef struct
+{
+    /// Virtual method table or NULL if elements need no reference counting
+    const pvector_vmt_t *vmt;
+    /// The root node of the tree
+    pvector_node_t *root;
+    /// The number of index bits below the root node
+    int shift;
+    /// Index of the first element of this vector in the tree
+    int start;
+    /// Number of elements in the vector
+    int size;
+} pvector_t;
+
+/**
+ * Initialize a empty persistent vector.
+ *
+ * @param vec The vector to initialize.
+ * @param vmt The virtual method table (may be NULL).
+ */
+extern void pvector_init (pvector_t *vec, const pvector_vmt_t *vmt);
+
+/**
+ * Initialize a vector with a shared copy of another vector. O(1).
+ *
+ * @param vec The vector to initialize.
+ * @param src The vector to copy.
+ */
+extern void pvector_init_copy (pvector_t *vec, const pvector_t *src);
+
+/**
+ * Initialize a vector with a part of another vector. O(1).
+ *
+ * @param vec The vector to initialize.
+ * @param src The source vector.
+ * @param pos The index of the first element to take.
+ * @param size The number of elements to take (clamped to source size).
+ */
+extern void pvector_init_slice (pvector_t *vec, const pvector_t *src, int pos, int size);
+
+/**
+ * Finalize the vector. Elements which are not shared with other
+ * vectors are released.
+ *
+ * @param vec The vector to finalize.
+ */
+extern void pvector_done (pvector_t *vec);
+
+/**
+ * Assign one vector to another. O(1).
+ *
+ * @param to The vector to assign to. The old contents is released.
+ * @param from The vector to copy.
+ */
+extern void pvector_set (pvector_t *to, const pvector_t *from);
+
+/**
+ * Get a element of the vector.
+ *
+ * @param vec The vector.
+ * @param pos The index of the element.
+ * @return The element or NULL if pos is out of range.
+ */
+extern void *pvector_get (const pvector_t *vec, int pos);
+
+/**
+ * Get a pointer to a contiguous run of vector elements, starting at
+ * given position. This is the fastest way to iterate over the vector:
+ *
+ * for (int pos = 0; pos < vec->size; ) {
+ *     void **items;
+ *     int count = pvector_chunk (vec, pos, &items);
+ *     ... process items [0 .. count-1] ...
+ *     pos += count;
+ * }
+ *
+ * @param vec The vector.
+ * @param pos The index of the first element.
+ * @param items Receives the pointer to the elements.
+ * @return The number of elements available at @a items (0 if none).
+ */
+extern int pvector_chunk (const pvector_t *vec, int pos, void ***items);
+
+/**
+ * Replace a element of the vector. The old element is released.
+ *
+ * @param vec The vector to modify.
+ * @param pos The index of the element to replace.
+ * @param item The new element. The vector takes over the reference.
+ * @return false if pos is out of range or not enough memory.
+ */
+extern bool pvector_replace (pvector_t *vec, int pos, void *item);
+
+/**
+ * Append a element to the end of the vector.
+ *
+ * @param vec The vector to modify.
+ * @param item The new element (must not be NULL). The vector takes
+ *     over the reference, so on failure the caller still owns it.
+ * @return false on memory allocation failure.
+ */
+extern bool pvector_append (pvector_t *vec, void *item);
+
+/**
+ * Append all elements of another vector to the end of the vector.
+ * Elements are shared, not copied.
+ *
+ * @param vec The vector to modify.
+ * @param tail The vector with elements to append.
+ * @return false on memory allocation failure (some elements
+ *     may have been appended).
+ */
+extern bool pvector_join (pvector_t *vec, const pvector_t *tail);
+
+/**
+ * Get the number of elements in the vector.
+ *
+ * @param vec The vector.
+ * @return The number of elements.
+ */
+static inline int pvector_size (const pvector_t *vec)
+{ return vec->size; }
+
+#endif /* __PVECTOR_H__ */
@@ -1,12 +1,15 @@
 /* The Cook project
  * Direct drop-in replacement for standard C library functions,
- * a simple portable repeatable random number generator implementation.
+ * a simple portable repeatable random number generator implementation,
+ * and the reentrant generators from rand.h.
  *
  * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
  * See file docs/COPYING for copying conditions
  */
 
-#include "useful.h"
+#include "rand.h"
+
+#include <string.h>
 
 /*
  * Xorshift RNG by George Marsaglia.
@@ -39,3 +42,111 @@ int rand ()
 
     return t + (state [4] += 362437);
 }
+
+// ---------- // ---------- // ---------- // ---------- // ---------- //
+
+/*
+ * xoshiro256** by David Blackman and Sebastiano Vigna.
+ * http://prng.di.unimi.it/xoshiro256starstar.c
+ */
+
+// splitmix64, recommended by the xoshiro authors to seed the state
+static uint64_t splitmix64 (uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+void rand_init (rand_state_t *rs, uint64_t seed)
+{
+    // splitmix64 never gives four zeros in a row, so the state is valid
+    for (int i = 0; i < ARRAY_LEN (rs->s); i++)
+        rs->s [i] = splitmix64 (&seed);
+}
+
+uint32_t rand_range (rand_state_t *rs, uint32_t n)
+{
+    /* Lemire's nearly divisionless method,
+     * https://arxiv.org/abs/1805.10941 */
+    uint64_t m = (uint64_t)rand_u32 (rs) * n;
+    uint32_t l = (uint32_t)m;
+    if (l < n)
+    {
+        uint32_t t = -n % n;
+        while (l < t)
+        {
+            m = (uint64_t)rand_u32 (rs) * n;
+            l = (uint32_t)m;
+        }
+    }
+
+    return (uint32_t)(m >> 32);
+}
+
+static inline void rand_store (uint8_t *dst, uint64_t x)
+{
+#if defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap64 (x);
+#endif
+    memcpy (dst, &x, sizeof (x));
+}
+
+void rand_fill (rand_state_t *rs, void *data, size_t size)
+{
+    // Work on a local copy, so the state is not stored back on every step
+    rand_state_t st = *rs;
+    uint8_t *dst = data;
+
+    for (; size >= 8; dst += 8, size -= 8)
+        rand_store (dst, rand_next (&st));
+
+    if (size)
+    {
+        // A tail shorter than 8 bytes consumes a whole number
+        uint8_t temp [8];
+        rand_store (temp, rand_next (&st));
+        memcpy (dst, temp, size);
+    }
+
+    *rs = st;
+}
+
+static void rand_jump_poly (rand_state_t *rs, const uint64_t poly [4])
+{
+    uint64_t s [4] = { 0, 0, 0, 0 };
+
+    for (int i = 0; i < 4; i++)
+        for (int b = 0; b < 64; b++)
+        {
+            if (poly [i] & (1ULL << b))
+                for (int j = 0; j < 4; j++)
+                    s [j] ^= rs->s [j];
+            rand_next (rs);
+        }
+
+    memcpy (rs->s, s, sizeof (s));
+}
+
+void rand_jump (rand_state_t *rs)
+{
+    static const uint64_t jump [4] =
+    {
+        0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+        0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+    };
+
+    rand_jump_poly (rs, jump);
+}
+
+void rand_long_jump (rand_state_t *rs)
+{
+    static const uint64_t long_jump [4] =
+    {
+        0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+        0x77710069854ee241ULL, 0x39109bb02acbe635ULL
+    };
+
+    rand_jump_poly (rs, long_jump);
+}
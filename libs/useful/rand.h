@@ -0,0 +1,110 @@
+/* The Cook project
+ * Pseudo-random number generators
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#ifndef __RAND_H__
+#define __RAND_H__
+
+#include "useful.h"
+
+/**
+ * The state of a xoshiro256** pseudo-random number generator
+ * by David Blackman and Sebastiano Vigna (http://prng.di.unimi.it/).
+ *
+ * Unlike the srand()/rand() replacement, which has a single global
+ * state, every rand_state_t is a independent generator, so every
+ * thread may have its own one and no locking is needed. To get
+ * non-overlapping streams for several threads, initialize one
+ * generator, then copy it and call rand_jump() on every next copy.
+ */
+typedef struct
+{
+    uint64_t s [4];
+} rand_state_t;
+
+/**
+ * Initialize the generator from a seed.
+ * Same seed always gives same sequence on all platforms.
+ *
+ * @param rs The generator state.
+ * @param seed Any number.
+ */
+extern void rand_init (rand_state_t *rs, uint64_t seed);
+
+static inline uint64_t rand_rotl (uint64_t x, int k)
+{ return (x << k) | (x >> (64 - k)); }
+
+/**
+ * Get next 64-bit pseudo-random number.
+ *
+ * @param rs The generator state.
+ * @return A random number.
+ */
+static inline uint64_t rand_next (rand_state_t *rs)
+{
+    uint64_t *s = rs->s;
+    uint64_t result = rand_rotl (s [1] * 5, 7) * 9;
+    uint64_t t = s [1] << 17;
+
+    s [2] ^= s [0];
+    s [3] ^= s [1];
+    s [1] ^= s [2];
+    s [0] ^= s [3];
+    s [2] ^= t;
+    s [3] = rand_rotl (s [3], 45);
+
+    return result;
+}
+
+/**
+ * Get next 32-bit pseudo-random number.
+ *
+ * @param rs The generator state.
+ * @return A random number.
+ */
+static inline uint32_t rand_u32 (rand_state_t *rs)
+{ return (uint32_t)(rand_next (rs) >> 32); }
+
+/**
+ * Get a uniformly distributed pseudo-random number in range 0..n-1.
+ *
+ * @param rs The generator state.
+ * @param n The number of possible values (must not be 0).
+ * @return A random number less than @a n.
+ */
+extern uint32_t rand_range (rand_state_t *rs, uint32_t n);
+
+/**
+ * Fill a memory block with pseudo-random bytes. The block gets the
+ * same sequence as calling rand_next() in a loop would give, stored
+ * as little-endian 64-bit numbers; a tail shorter than 8 bytes
+ * consumes one whole number.
+ *
+ * @param rs The generator state.
+ * @param data The memory to fill.
+ * @param size The size of the block in bytes.
+ */
+extern void rand_fill (rand_state_t *rs, void *data, size_t size);
+
+/**
+ * Advance the generator by 2^128 steps. This is used to generate
+ * 2^128 non-overlapping sequences for parallel computations.
+ *
+ * @param rs The generator state.
+ */
+extern void rand_jump (rand_state_t *rs);
+
+/**
+ * Advance the generator by 2^192 steps. This is used to generate
+ * 2^64 starting points, from each of which rand_jump() generates
+ * 2^64 non-overlapping sequences (e.g. one per process, then one
+ * per thread).
+ *
+ * @param rs The generator state.
+ */
+extern void rand_long_jump (rand_state_t *rs);
+
+#endif /* __RAND_H__ */
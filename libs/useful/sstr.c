@@ -0,0 +1,84 @@
+/* The Cook project
+ * Compact strings with inline storage for short text
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#include "sstr.h"
+
+#include <string.h>
+
+void sstr_init (sstr_t *sstr)
+{
+    sstr->data [0] = '\0';
+    sstr->size = 0;
+}
+
+bool sstr_init_c_copy (sstr_t *sstr, const char *cstr, int size)
+{
+    if (size < 0)
+        size = cstr ? (int)strlen (cstr) : 0;
+
+    if (size > SSTR_INLINE_MAX)
+    {
+        sstr->size = SSTR_LONG;
+        if (str_init_c_copy (&sstr->str, cstr, size))
+            return true;
+
+        sstr_init (sstr);
+        return false;
+    }
+
+    memcpy (sstr->data, cstr, (size_t)size);
+    sstr->data [size] = '\0';
+    sstr->size = (uint8_t)size;
+    return true;
+}
+
+bool sstr_init_str (sstr_t *sstr, str_t *str)
+{
+    if (str->size > SSTR_INLINE_MAX)
+    {
+        sstr->size = SSTR_LONG;
+        return str_init_copy (&sstr->str, str);
+    }
+
+    return sstr_init_c_copy (sstr, str->data, str->size);
+}
+
+bool sstr_set (sstr_t *sstr, str_t *str)
+{
+    // The source may be a view of ourselves, so copy it first
+    sstr_t tmp;
+    if (!sstr_init_str (&tmp, str))
+        return false;
+
+    sstr_done (sstr);
+    *sstr = tmp;
+    return true;
+}
+
+void sstr_done (sstr_t *sstr)
+{
+    if (!sstr_is_inline (sstr))
+        str_done (&sstr->str);
+
+    sstr_init (sstr);
+}
+
+void sstr_str (const sstr_t *sstr, str_t *view)
+{
+    if (sstr_is_inline (sstr))
+        str_init_c_const (view, sstr->data, sstr->size);
+    else
+        str_init_copy (view, (str_t *)&sstr->str);
+}
+
+const char *sstr_c (const sstr_t *sstr)
+{
+    if (sstr_is_inline (sstr))
+        return sstr->data;
+
+    return str_c (&sstr->str);
+}
@@ -0,0 +1,126 @@
+/* The Cook project
+ * Compact strings with inline storage for short text
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#ifndef __SSTR_H__
+#define __SSTR_H__
+
+#include "str.h"
+
+/// The amount of bytes available for inline storage (including the '\0')
+#define SSTR_INLINE_SIZE    ((int)sizeof (str_t))
+
+/// Longest string that is stored inline
+#define SSTR_INLINE_MAX     (SSTR_INLINE_SIZE - 1)
+
+/// The value of sstr_t.size which says the string is stored in str_t
+#define SSTR_LONG           0xff
+
+/**
+ * A compact string object, best suited for short words and names.
+ *
+ * Strings up to SSTR_INLINE_MAX bytes long are stored right inside
+ * the object, so they need neither heap memory nor a reference counter.
+ * Longer strings are kept in a regular str_t with all of its
+ * copy-on-write goodness.
+ *
+ * A str_t view returned by sstr_str() for a short string points inside
+ * the sstr_t object, so don't move the object while the view is in use.
+ */
+typedef struct
+{
+    union
+    {
+        /// Long strings are stored in a regular string object
+        str_t str;
+        /// Short zero-terminated strings are stored right here
+        char data [SSTR_INLINE_SIZE];
+    };
+    /// Size of the inline string or SSTR_LONG
+    uint8_t size;
+} sstr_t;
+
+/**
+ * Initialize an empty compact string.
+ *
+ * @param sstr The compact string object.
+ */
+extern void sstr_init (sstr_t *sstr);
+
+/**
+ * Initialize a compact string with a copy of a C string.
+ *
+ * @param sstr The compact string object.
+ * @param cstr A pointer to the C string.
+ * @param size String size in bytes or -1 to use strlen()
+ * @return false if memory allocation failed.
+ */
+extern bool sstr_init_c_copy (sstr_t *sstr, const char *cstr, int size);
+
+/**
+ * Initialize a compact string from a string object.
+ * Short strings are copied inline, long strings are shared.
+ *
+ * @param sstr The compact string object.
+ * @param str The string to copy.
+ * @return false if memory allocation failed.
+ */
+extern bool sstr_init_str (sstr_t *sstr, str_t *str);
+
+/**
+ * Assign a new value to a compact string.
+ *
+ * @param sstr The compact string object. Old value will be freed.
+ * @param str The string to copy.
+ * @return false if memory allocation failed.
+ */
+extern bool sstr_set (sstr_t *sstr, str_t *str);
+
+/**
+ * Finalize the compact string.
+ *
+ * @param sstr The compact string object.
+ */
+extern void sstr_done (sstr_t *sstr);
+
+/**
+ * Check if the string is stored inline.
+ *
+ * @param sstr The compact string object.
+ * @return true if no heap memory is used by the string.
+ */
+static inline bool sstr_is_inline (const sstr_t *sstr)
+{ return sstr->size != SSTR_LONG; }
+
+/**
+ * Get the size of the compact string.
+ *
+ * @param sstr The compact string object.
+ * @return String size in bytes.
+ */
+static inline int sstr_size (const sstr_t *sstr)
+{ return sstr_is_inline (sstr) ? sstr->size : sstr->str.size; }
+
+/**
+ * Get a str_t view of the compact string. Short strings are returned as
+ * constants referring to the inline data, so the view stays valid as long
+ * as the compact string is not modified, freed or moved. Long strings are
+ * returned as a shared copy. In any case free the view with str_done().
+ *
+ * @param sstr The compact string object.
+ * @param view The string object that will refer to the text.
+ */
+extern void sstr_str (const sstr_t *sstr, str_t *view);
+
+/**
+ * Get a zero-terminated C string.
+ *
+ * @param sstr The compact string object.
+ * @return A pointer to the C string.
+ */
+extern const char *sstr_c (const sstr_t *sstr);
+
+#endif /* __SSTR_H__ */
@@ -6,17 +6,27 @@
  */
 
 #include "str.h"
+#include "intern.h"
 #include "useful.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
-
-/* The library is not thread-safe. It's easy to make it so,
- * but would require fiddling with spinlocks and all that
- * non-portable stuff, so this is left as an exercise
- * to the reader. Cook doesn't need thread safety.
+#include <errno.h>
+#include <stdatomic.h>
+
+#if defined (__unix__) || defined (__APPLE__)
+#define HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* Reference counters are atomic, so shared string data may be passed
+ * between threads freely. Modifying a single str_t object from several
+ * threads at once is still not allowed, just like with any other object.
  */
 
 // An empty string
@@ -40,104 +50,168 @@ static int str_alloc_size (int size)
     return 0;
 }
 
-/* The global string reference counter pool.
+/* The shared string data buffer.
  *
- * str_t.refcnt is a index (offset by 1) into str_ref[],
- * which contains the number of references to a particular string.
+ * Buffers allocated by the library keep string data right after
+ * the header. Buffers passed to us by str_init_c_prealloc() are
+ * kept where they are, and the header just points to them.
+ * Files loaded by str_init_file() are mapped into memory read-only,
+ * such buffers are never written to and are unmapped instead of freed.
  *
  * A string cannot be modified if its reference counter is > 1.
  * If that needs to be done, the strings has to be unshared first.
  */
-static int *str_ref = NULL;
-static int str_ref_count = 0;
+struct _str_buf_t
+{
+    /// The number of str_t objects referencing this buffer
+    atomic_int refcnt;
+    /// External string data, or NULL if data follows the header
+    char *ext;
+    /// The size of the file mapped at ext, or 0 if ext was malloc()ed
+    size_t mapped;
+};
 
-/* Get the shared string reference counter.
+/* The number of live string buffers, used to detect leaks.
  */
-int str_getref (int ref)
-{
-    if (ref == REFCNT_UNUSED)
-        return 1;
+static atomic_int str_buf_count = 0;
 
-    assert ((ref > 0) && (ref <= str_ref_count));
+/* The total number of heap (re)allocations made by the library.
+ */
+static atomic_long str_heap_allocs = 0;
 
-    return str_ref [ref - 1];
+static inline char *str_buf_data (str_buf_t *buf)
+{
+    return buf->ext ? buf->ext : (char *)(buf + 1);
 }
 
-static int str_newref ()
+/**
+ * Allocate a new string buffer with a reference count of 1.
+ * @param allocated The size of string data to allocate.
+ * @param ext The preallocated data buffer, or NULL to allocate
+ *      data together with the header.
+ * @return The new buffer or NULL if not enough memory.
+ */
+static str_buf_t *str_buf_new (int allocated, char *ext)
 {
-    /* @OPT@ A more optimal approach would be to keep the free refcnt's
-     * in a chained list. We have to profile it yet to see
-     * if that makes sense.
-     */
-    int ref;
-    for (ref = 0; ref < str_ref_count; ref++)
-        if (str_ref [ref] == 0)
-            goto leave;
+    size_t size = sizeof (str_buf_t);
+    if (!ext)
+        size += (size_t)allocated;
+
+    str_buf_t *buf = malloc (size);
+    if (!buf)
+        return NULL;
 
-    int new_ref_count = (str_ref_count < 256) ? 256 : str_ref_count * 2;
-    str_ref = realloc (str_ref, (size_t)new_ref_count * sizeof (str_ref [0]));
-    // if realloc returns NULL here, we're in a big trouble...
-    assert (str_ref);
+    atomic_init (&buf->refcnt, 1);
+    buf->ext = ext;
+    buf->mapped = 0;
 
-    memset (str_ref + str_ref_count, 0,
-            sizeof (str_ref [0]) * (size_t)(new_ref_count - str_ref_count));
+    atomic_fetch_add_explicit (&str_buf_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit (&str_heap_allocs, 1, memory_order_relaxed);
+    return buf;
+}
 
-    ref = str_ref_count;
-    str_ref_count = new_ref_count;
+/**
+ * Get the number of references to string data.
+ * Strings not owning their data are never shared.
+ * @param str The string object.
+ * @return The number of str_t objects sharing string data.
+ */
+static inline int str_getref (const str_t *str)
+{
+    if (!str->buf)
+        return 1;
 
-leave:
-    str_ref [ref] = 1;
-    return ref + 1;
+    return atomic_load_explicit (&str->buf->refcnt, memory_order_acquire);
 }
 
 /**
- * Increment the string reference counter.
- * Allocate a new one if not already.
- * @param idx_p A pointer to shared string data refcnt index.
- * @return the index of the incremented reference counter.
+ * Check if string data may be modified in-place.
+ * @param str The string object.
+ * @return true if nobody else uses string data and it is writable.
  */
-static int str_incref (int *ref_p)
+static inline bool str_writable (const str_t *str)
 {
-    int ref = *ref_p;
+    return (str_getref (str) == 1) && !(str->buf && str->buf->mapped);
+}
 
-    // allocate a new refcnt?
-    if (ref == REFCNT_UNUSED)
-        *ref_p = ref = str_newref ();
+/**
+ * Increment the string buffer reference counter.
+ * @param buf The string buffer.
+ */
+static inline void str_incref (str_buf_t *buf)
+{
+    atomic_fetch_add_explicit (&buf->refcnt, 1, memory_order_relaxed);
+}
 
-    if (ref == REFCNT_UNUSED)
-        return REFCNT_UNUSED;
+/**
+ * Decrement the string buffer reference counter,
+ * freeing the buffer when the last reference is gone.
+ * @param buf The string buffer.
+ */
+static void str_decref (str_buf_t *buf)
+{
+    if (atomic_fetch_sub_explicit (&buf->refcnt, 1, memory_order_acq_rel) != 1)
+        return;
 
-    assert ((ref > 0) && (ref <= str_ref_count));
+#ifdef HAVE_MMAP
+    if (buf->mapped)
+        munmap (buf->ext, buf->mapped);
+    else
+#endif
+        free (buf->ext);
+    free (buf);
 
-    str_ref [ref - 1]++;
-    return ref;
+    atomic_fetch_sub_explicit (&str_buf_count, 1, memory_order_relaxed);
 }
 
 /**
- * Decrement the shared string reference counter,
- * @param idx The refcnt index.
- * @return the new (decremented) value.
+ * Resize the data of a non-shared string buffer.
+ * @param str The string which owns the buffer exclusively.
+ * @param allocated The new amount of memory available after str->data.
+ * @return false if not enough memory (the string is left intact).
  */
-static int str_decref (int ref)
+static bool str_buf_resize (str_t *str, int allocated)
 {
-    if (ref == REFCNT_UNUSED)
-        return 0;
+    str_buf_t *buf = str->buf;
+    // the string may be a substring starting somewhere inside the buffer
+    int ofs = (int)(str->data - str_buf_data (buf));
 
-    assert ((ref > 0) && (ref <= str_ref_count));
+    if (buf->ext)
+    {
+        char *ext = realloc (buf->ext, (size_t)(ofs + allocated));
+        if (!ext)
+            return false;
 
-    return --str_ref [ref - 1];
+        buf->ext = ext;
+    }
+    else
+    {
+        buf = realloc (buf, sizeof (str_buf_t) + (size_t)(ofs + allocated));
+        if (!buf)
+            return false;
+    }
+
+    atomic_fetch_add_explicit (&str_heap_allocs, 1, memory_order_relaxed);
+
+    str->buf = buf;
+    str->data = str_buf_data (buf) + ofs;
+    str->allocated = allocated;
+    return true;
+}
+
+long str_alloc_count ()
+{
+    return atomic_load_explicit (&str_heap_allocs, memory_order_relaxed);
 }
 
 void str_finalize ()
 {
-    for (int ref = 0; ref < str_ref_count; ref++)
-        if (str_ref [ref] != 0)
-            fprintf (stderr, "%s: Refcount %u has value %u\n",
-                     __FUNCTION__, ref, str_ref [ref]);
+    str_intern_finalize ();
 
-    free (str_ref);
-    str_ref = NULL;
-    str_ref_count = 0;
+    int count = atomic_load (&str_buf_count);
+    if (count != 0)
+        fprintf (stderr, "%s: %d string buffers are still referenced\n",
+                 __FUNCTION__, count);
 }
 
 // --------------------------------------------------------------- //
@@ -148,7 +222,7 @@ void str_init (str_t *str)
     /*
     str->data = NULL;
     str->size = str->allocated = 0;
-    str->refcnt = REFCNT_UNUSED;
+    str->buf = NULL;
     */
 }
 
@@ -169,7 +243,8 @@ void str_init_c_const (str_t *str, const char *cstr, int size)
     str->allocated = 0;
     // we're not going to break const since (allocated == 0).
     str->data = (char *)cstr;
-    str->refcnt = REFCNT_UNUSED;
+    str->buf = NULL;
+    str->hash = 0;
 }
 
 str_t *str_new_c_const (const char *cstr, int size)
@@ -211,10 +286,19 @@ void str_init_c_prealloc (str_t *str, char *cstr, int size)
     int allocated;
     str_c_detect (cstr, &size, &allocated);
 
+    str->buf = allocated ? str_buf_new (allocated, cstr) : NULL;
+    if (!str->buf)
+    {
+        // The buffer is ours now, and nobody else will free it
+        free (cstr);
+        *str = empty_str;
+        return;
+    }
+
     str->size = size;
-    str->allocated = allocated;
     str->data = cstr;
-    str->refcnt = REFCNT_UNUSED;
+    str->allocated = allocated;
+    str->hash = 0;
 }
 
 str_t *str_new_c_prealloc (char *cstr, int size)
@@ -233,23 +317,157 @@ bool str_init_c_copy (str_t *str, const char *cstr, int size)
     str_c_detect (cstr, &size, NULL);
 
     str->size = size;
+    str->hash = 0;
     str->allocated = str_alloc_size (size);
     if (str->allocated)
     {
-        str->data = malloc ((size_t)str->allocated);
-        if (!str->data)
+        str->buf = str_buf_new (str->allocated, NULL);
+        if (!str->buf)
+        {
+            str->size = str->allocated = 0;
             return false;
+        }
 
+        str->data = str_buf_data (str->buf);
         memcpy (str->data, cstr, (size_t)size);
         str->data [size] = '\0';
     }
     else
+    {
         str->data = NULL;
+        str->buf = NULL;
+    }
 
-    str->refcnt = REFCNT_UNUSED;
     return true;
 }
 
+bool str_init_alloc (str_t *str, int size)
+{
+    str_init (str);
+    if (size <= 0)
+        return true;
+
+    str->buf = str_buf_new (size + 1, NULL);
+    if (!str->buf)
+        return false;
+
+    str->data = str_buf_data (str->buf);
+    str->data [size] = '\0';
+    str->size = size;
+    str->allocated = size + 1;
+    return true;
+}
+
+/* Read the whole file into a allocated string buffer.
+ */
+static bool str_read_file (str_t *str, FILE *file)
+{
+    str_init (str);
+
+    for (;;)
+    {
+        // Grow the buffer geometrically, str_expand takes care of it
+        if (!str_expand (str, imax (str->allocated - str->size - 1, 4096)))
+            break;
+
+        int avail = str->allocated - str->size - 1;
+        size_t count = fread (str->data + str->size, 1, (size_t)avail, file);
+        str->size += (int)count;
+        str->data [str->size] = '\0';
+
+        if (count < (size_t)avail)
+        {
+            if (ferror (file))
+                break;
+            return true;
+        }
+    }
+
+    str_done (str);
+    return false;
+}
+
+#ifdef HAVE_MMAP
+/* Map a regular file into memory. If file cannot be mapped,
+ * data is set to NULL and the function returns true.
+ */
+static bool str_map_file (str_t *str, int fd)
+{
+    struct stat st;
+    if (fstat (fd, &st) != 0)
+        return false;
+
+    // Pipes and such must be read
+    if (!S_ISREG (st.st_mode) || (st.st_size == 0))
+        return true;
+
+    if (st.st_size >= INT32_MAX)
+    {
+        errno = EFBIG;
+        return false;
+    }
+
+    size_t size = (size_t)st.st_size;
+    char *data = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+        return true;
+
+    str_buf_t *buf = str_buf_new (0, data);
+    if (!buf)
+    {
+        munmap (data, size);
+        return false;
+    }
+    buf->mapped = size;
+
+    // The tail of last page is filled with zeros, so usually
+    // we get a zero-terminated string for free
+    long page_size = sysconf (_SC_PAGESIZE);
+    bool zero_terminated = (page_size > 0) && (size % (size_t)page_size);
+
+    str->data = data;
+    str->size = (int)size;
+    str->allocated = (int)size + (zero_terminated ? 1 : 0);
+    str->buf = buf;
+    return true;
+}
+#endif
+
+bool str_init_file (str_t *str, const char *filename)
+{
+    str_init (str);
+
+#ifdef HAVE_MMAP
+    int fd = open (filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    bool ok = str_map_file (str, fd);
+    if (ok && !str->buf)
+    {
+        FILE *file = fdopen (fd, "rb");
+        if (file)
+        {
+            ok = str_read_file (str, file);
+            fclose (file);
+            return ok;
+        }
+        ok = false;
+    }
+
+    close (fd);
+    return ok;
+#else
+    FILE *file = fopen (filename, "rb");
+    if (!file)
+        return false;
+
+    bool ok = str_read_file (str, file);
+    fclose (file);
+    return ok;
+#endif
+}
+
 str_t *str_new_c_copy (const char *cstr, int size)
 {
     str_t *ret = malloc (sizeof (str_t));
@@ -267,8 +485,9 @@ str_t *str_new_c_copy (const char *cstr, int size)
 
 bool str_init_copy (str_t *str, str_t *copy)
 {
-    // str_set->str_done will not free anything if allocated == 0
+    // str_set->str_done will not free anything if buf == NULL
     str->allocated = 0;
+    str->buf = NULL;
     return str_set (str, copy);
 }
 
@@ -304,16 +523,21 @@ bool str_init_substr (str_t *str, str_t *src, int pos, int size)
         str->allocated = 0;
         str->size = size;
         str->data = src->data + pos;
-        str->refcnt = REFCNT_UNUSED;
+        str->buf = NULL;
+        str->hash = (size == src->size) ? src->hash : 0;
         return true;
     }
 
-    // If the "substring" is really the whole string, do a smart copy
-    if (pos == 0 && size == src->size)
-        return str_init_copy (str, src);
+    // Otherwise share the buffer; the substring is copied
+    // only when it gets modified or needs a terminating zero.
+    str_incref (src->buf);
 
-    // Otherwise we have to make a complete copy
-    return str_init_c_copy (str, src->data + pos, size);
+    str->data = src->data + pos;
+    str->size = size;
+    str->allocated = src->allocated - pos;
+    str->buf = src->buf;
+    str->hash = (size == src->size) ? src->hash : 0;
+    return true;
 }
 
 str_t *str_new_substr (str_t *src, int pos, int size)
@@ -333,17 +557,15 @@ str_t *str_new_substr (str_t *src, int pos, int size)
 
 void str_done (str_t *str)
 {
-    if (str->allocated)
+    if (str->buf)
     {
-        int refs = str_decref (str->refcnt);
-        if (refs == 0)
-            free (str->data);
-
-        str->allocated = 0;
+        str_decref (str->buf);
+        str->buf = NULL;
     }
 
     str->size = 0;
-    str->refcnt = REFCNT_UNUSED;
+    str->allocated = 0;
+    str->hash = 0;
 }
 
 void str_free (str_t *str)
@@ -368,7 +590,22 @@ const char *str_c (const str_t *str)
         return str->data;
 
     // Fine, we can't do anything here since it's a const
-    return "";
+    if (!str->buf)
+        return "";
+
+    /* A substring of a shared buffer. Making it zero-terminated doesn't
+     * change the string value, so we pretend the object is const.
+     */
+    str_t *sub = (str_t *)str;
+    if (!str_unshare (sub))
+        return "";
+
+    // A sole owner may still have no room for the terminator
+    if ((sub->allocated <= sub->size) && !str_expand (sub, 1))
+        return "";
+
+    sub->data [sub->size] = '\0';
+    return sub->data;
 }
 
 static bool str_unshare_expand (str_t *str, int xsize)
@@ -376,22 +613,30 @@ static bool str_unshare_expand (str_t *str, int xsize)
     if (!str || (xsize < 0))
         return false;
 
-    if (str_getref (str->refcnt) > 1)
+    // Everyone calling this is going to modify the string
+    str->hash = 0;
+
+    if (!str_writable (str))
     {
+        str_buf_t *buf = NULL;
         int allocated = str_alloc_size (str->size + xsize);
         if (allocated)
         {
-            char *data = malloc ((size_t)allocated);
-            if (!data)
+            buf = str_buf_new (allocated, NULL);
+            if (!buf)
                 return false;
 
-            memcpy (data, str->data, (size_t)str->size + 1);
-            str->data = data;
+            // this may be a substring, so don't copy the terminator
+            char *data = str_buf_data (buf);
+            memcpy (data, str->data, (size_t)str->size);
+            data [str->size] = '\0';
         }
 
+        // If others dropped their references meanwhile, this frees the data
+        str_decref (str->buf);
+        str->buf = buf;
+        str->data = buf ? str_buf_data (buf) : NULL;
         str->allocated = allocated;
-        str_decref (str->refcnt);
-        str->refcnt = REFCNT_UNUSED;
     }
 
     return true;
@@ -413,53 +658,41 @@ bool str_expand (str_t *str, int xsize)
     if (allocated <= str->allocated)
         return true;
 
-    if (str->allocated == 0)
+    if (!str->buf)
     {
-        char *data = malloc ((size_t)allocated);
-        if (!data)
+        str_buf_t *buf = str_buf_new (allocated, NULL);
+        if (!buf)
             return false;
 
+        char *data = str_buf_data (buf);
         memcpy (data, str->data, (size_t)str->size);
         data [str->size] = '\0';
-        str->data = data;
-    }
-    else
-        str->data = realloc (str->data, (size_t)allocated);
 
-    str->allocated = allocated;
-
-    if (str->data)
+        str->buf = buf;
+        str->data = data;
+        str->allocated = allocated;
         return true;
+    }
 
-    // whoops, we lost it
-    str->size = 0;
-    str->allocated = 0;
-    return false;
+    return str_buf_resize (str, allocated);
 }
 
 bool str_set (str_t *to, str_t *from)
 {
+    if (to == from)
+        return true;
+
+    // if string is not allocated, do not allocate the copy
+    if (from->buf)
+        str_incref (from->buf);
+
     str_done (to);
 
+    to->data = from->data;
     to->size = from->size;
     to->allocated = from->allocated;
-
-    // if string is not allocated, do not allocate the copy
-    if (to->allocated == 0)
-    {
-        to->refcnt = REFCNT_UNUSED;
-        to->data = from->data;
-    }
-    else
-    {
-        to->refcnt = str_incref (&from->refcnt);
-
-        if (to->refcnt == REFCNT_UNUSED)
-            // Sharing failed, do a regular copy
-            return str_init_c_copy (to, from->data, from->size);
-        else
-            to->data = from->data;
-    }
+    to->buf = from->buf;
+    to->hash = from->hash;
 
     return true;
 }
@@ -474,15 +707,9 @@ int str_cmp (const str_t *str1, const str_t *str2)
     if (!str2)
         return +1;
 
-    // If strings are shared, the allocated size is always equal
-    if (str1->allocated == str2->allocated)
-    {
-        if (!str1->allocated)
-            return 0;
-
-        if (str1->data == str2->data)
-            return 0;
-    }
+    // Shared strings point to same data
+    if ((str1->data == str2->data) && (str1->size == str2->size))
+        return 0;
 
     uint ml = umin ((uint)str1->size, (uint)str2->size);
     int res = memcmp (str1->data, str2->data, ml);
@@ -492,6 +719,35 @@ int str_cmp (const str_t *str1, const str_t *str2)
     return (int)str1->size - (int)str2->size;
 }
 
+uint64_t str_hash_c (const char *cstr, int size)
+{
+    uint64_t hash = hash64 (cstr, (size_t)size, 0);
+    // Zero means "not computed"
+    return hash ? hash : 1;
+}
+
+uint64_t str_hash (str_t *str)
+{
+    if (!str->hash)
+        str->hash = str_hash_c (str->data, str->size);
+    return str->hash;
+}
+
+bool str_equal (const str_t *str1, const str_t *str2)
+{
+    if (str1 == str2)
+        return true;
+
+    if (str1->size != str2->size)
+        return false;
+
+    if (str1->hash && str2->hash && (str1->hash != str2->hash))
+        return false;
+
+    return (str1->data == str2->data) ||
+        (memcmp (str1->data, str2->data, (size_t)str1->size) == 0);
+}
+
 bool str_insert (str_t *str, int pos, const str_t *insert)
 {
     if (!insert || (pos > str->size))
@@ -505,6 +761,7 @@ bool str_insert (str_t *str, int pos, const str_t *insert)
         (pos == str->size) && (str->data + str->size == insert->data))
     {
         str->size += insert->size;
+        str->hash = 0;
         return true;
     }
 
@@ -539,16 +796,13 @@ bool str_append_c_const (str_t *str, const char *cstr, int size)
         return true;
     }
 
-    int allocated;
-    str_c_detect (cstr, &size, &allocated);
+    str_c_detect (cstr, &size, NULL);
 
-    if (cstr == str->data + str->size)
+    if (!str->buf && (cstr == str->data + str->size))
     {
-        // Optimization: expand string in-place
+        // Optimization: expand a constant string in-place
         str->size += size;
-        if (str->allocated)
-            str->allocated += allocated;
-
+        str->hash = 0;
         return true;
     }
 
@@ -572,7 +826,8 @@ bool str_replace (str_t *str, int pos, int size, str_t *repl)
     if ((pos + size < pos) || (pos + size > str->size))
         size = str->size - pos;
 
-    if (!str_expand (str, repl->size - size))
+    // Shrinking strings need no extra memory, but still have to be unshared
+    if (!str_expand (str, imax (repl->size - size, 0)))
         return false;
 
     if (size != repl->size)
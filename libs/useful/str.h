@@ -10,6 +10,15 @@
 
 #include "useful.h"
 
+/**
+ * The header of a string data buffer owned by the string library.
+ * It holds the atomic reference counter shared by all str_t objects
+ * using same buffer. For buffers allocated by the library the header
+ * is placed right before the string data, so finding the reference
+ * counter never requires any lookups.
+ */
+typedef struct _str_buf_t str_buf_t;
+
 /**
  * This object encapsulates a non-zero-terminated string
  * with explicit length and copy-on-write semantics.
@@ -17,6 +26,10 @@
  * A zero character is always ensured to be present after
  * the end of the string (except cases when the string
  * is a non-zero-terminated constant).
+ *
+ * Reference counters are atomic, so str_t objects sharing same data
+ * may be copied, modified and freed from different threads. A single
+ * str_t object must not be modified from several threads at once.
  */
 typedef struct _str_t
 {
@@ -24,26 +37,25 @@ typedef struct _str_t
     char *data;
     /// String size in bytes (not characters!)
     int size;
-    /// The amount of memory allocated, or 0 if memory was not allocated
+    /// Memory available starting at data, or 0 if memory was not allocated
     int allocated;
-    /// Reference counter is shared by all instances of same string data
-    int refcnt;
+    /// Shared data buffer, or NULL if string data is not owned by us
+    str_buf_t *buf;
+    /// Cached string hash (see str_hash()), or 0 if not computed yet
+    uint64_t hash;
 } str_t;
 
-/// This value says that string is not shared
-#define REFCNT_UNUSED	0
-
 /**
  * A simple macro to declare initialized str_t objects.
  * Usage like this: static const str_t x = STR_INIT_C ("blah");
  */
-#define STR_INIT_C(s)   { (char *)s, sizeof (s) - 1, 0, REFCNT_UNUSED }
+#define STR_INIT_C(s)   { (char *)s, sizeof (s) - 1, 0, NULL, 0 }
 
 /**
  * Empty string initializer.
  * In fact, filling str_t with zeros using memset is enough.
  */
-#define STR_INIT_EMPTY  { NULL, 0, 0, REFCNT_UNUSED }
+#define STR_INIT_EMPTY  { NULL, 0, 0, NULL, 0 }
 
 /**
  * Initialize an empty string.
@@ -86,9 +98,11 @@ extern str_t *str_new_c_const (const char *cstr, int size);
 /**
  * Initialize a string from a preallocated data buffer.
  * The initialized string should be freed with str_done().
+ * The string takes ownership of the buffer; if there's not enough
+ * memory to do that, the buffer is freed and the string is left empty.
  *
  * @param str The preallocated string object.
- * @param cstr The preallocated string data.
+ * @param cstr The string data allocated with malloc().
  * @param size String size in bytes (not including terminating \0)
  * or -1 to use strlen()
  */
@@ -123,6 +137,34 @@ extern bool str_init_c_copy (str_t *str, const char *cstr, int size);
  */
 extern str_t *str_new_c_copy (const char *cstr, int size);
 
+/**
+ * Initialize a string with a newly allocated buffer that fits exactly
+ * @a size bytes plus the terminating zero. The string size is set
+ * to @a size, but the contents of the string is undefined, it is
+ * supposed the caller will fill it.
+ *
+ * @param str The string object to initialize.
+ * @param size String size in bytes.
+ * @return false if memory allocation failed.
+ */
+extern bool str_init_alloc (str_t *str, int size);
+
+/**
+ * Initialize a string with the contents of a file.
+ *
+ * Where the OS supports it, regular files are mapped into memory
+ * read-only, so no data is copied at all: pages are loaded on demand,
+ * and the mapping is released when the last string referring to it
+ * is freed. Such strings are copied as soon as they get modified.
+ * Other files (and all files on systems without mmap()) are read into
+ * a allocated buffer.
+ *
+ * @param str The string object to initialize.
+ * @param filename The name of the file to load.
+ * @return false if the file cannot be read (see errno for details).
+ */
+extern bool str_init_file (str_t *str, const char *filename);
+
 /**
  * Initialize a string object with a copy of the passed string.
  * The string data is shared between instances. Unless you
@@ -146,7 +188,9 @@ extern str_t *str_new_copy (str_t *copy);
 
 /**
  * Initialize a string with a part of other string.
- * The strings will be shared.
+ * The strings will be shared: the substring refers to the data buffer
+ * of the source string, and is copied only when it gets modified,
+ * or when str_c() needs to put a zero after its end.
  *
  * @param str The string to initialize.
  * @param src A part of this string will be assigned to @a str.
@@ -185,7 +229,8 @@ extern void str_free (str_t *str);
 /**
  * Convert a str_t back into a C zero-terminated string.
  * The function will return an empty string if str_t object
- * is not zero-terminated.
+ * is a constant which is not zero-terminated. Substrings of
+ * shared strings are copied, if needed, to add the terminator.
  *
  * @param str The string to return a pointer to.
  * @return A standard C char* pointing to a zero-terminated
@@ -233,6 +278,41 @@ extern bool str_set (str_t *to, str_t *from);
  */
 extern int str_cmp (const str_t *str1, const str_t *str2);
 
+/**
+ * Get the hash of the string contents.
+ *
+ * The hash is computed on first use and cached in the string object,
+ * so subsequent calls are free. All str_xxx functions that modify
+ * the string drop the cached value; if you write to str->data directly,
+ * set str->hash to 0 afterwards. Since the hash is stored into the
+ * object, don't use this on strings placed in read-only memory
+ * (e.g. static const str_t).
+ *
+ * @param str The string to hash.
+ * @return A non-zero 64-bit hash value.
+ */
+extern uint64_t str_hash (str_t *str);
+
+/**
+ * Compute the hash of a memory block same way str_hash() does.
+ *
+ * @param cstr A pointer to the data.
+ * @param size Data size in bytes.
+ * @return A non-zero 64-bit hash value.
+ */
+extern uint64_t str_hash_c (const char *cstr, int size);
+
+/**
+ * Check if two strings are equal. This is usually much faster than
+ * str_cmp(): strings of different length, as well as strings with
+ * different cached hashes, are rejected without looking at the data.
+ *
+ * @param str1 The first string to compare
+ * @param str2 The second string to compare
+ * @return true if strings have same contents.
+ */
+extern bool str_equal (const str_t *str1, const str_t *str2);
+
 /**
  * Insert a substring into a string.
  * Take care with multibyte characters, the function works at byte level.
@@ -301,10 +381,18 @@ extern bool str_delete (str_t *str, int pos, int size);
  */
 extern bool str_find_char (str_t *str, int *pos, char find);
 
+/**
+ * Get the number of heap memory allocations and reallocations
+ * for string data made so far. Useful for profiling.
+ *
+ * @return The total number of allocations.
+ */
+extern long str_alloc_count (void);
+
 /**
  * Finalize the string library, freeing global allocated variables.
  * Call this after you have freed all string objects, otherwise it
- * will print warnings regarding hanging string data references.
+ * will print warnings regarding hanging string data buffers.
  */
 extern void str_finalize (void);
 
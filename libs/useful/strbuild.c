@@ -0,0 +1,140 @@
+/* The Cook project
+ * A string builder for long strings assembled from many pieces
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#include "strbuild.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// The size of the first chunk
+#define STR_CHUNK_MIN   256
+// Stop doubling chunk sizes after this
+#define STR_CHUNK_MAX   (1024 * 1024)
+
+struct _str_chunk_t
+{
+    /// Next chunk in chain
+    str_chunk_t *next;
+    /// Chunk capacity
+    int allocated;
+    /// The number of used bytes in the chunk
+    int size;
+    /// Chunk data follows
+    char data [];
+};
+
+void str_builder_init (str_builder_t *sb)
+{
+    sb->first = sb->last = NULL;
+    sb->size = 0;
+}
+
+void str_builder_done (str_builder_t *sb)
+{
+    str_chunk_t *cur = sb->first;
+    while (cur)
+    {
+        str_chunk_t *next = cur->next;
+        free (cur);
+        cur = next;
+    }
+
+    str_builder_init (sb);
+}
+
+/* Add a new chunk to the chain, large enough to hold at least xsize bytes.
+ */
+static bool str_builder_grow (str_builder_t *sb, int xsize)
+{
+    int allocated = sb->last ? sb->last->allocated * 2 : STR_CHUNK_MIN;
+    if (allocated > STR_CHUNK_MAX)
+        allocated = STR_CHUNK_MAX;
+    if (allocated < xsize)
+        allocated = xsize;
+
+    str_chunk_t *chunk = malloc (sizeof (str_chunk_t) + (size_t)allocated);
+    if (!chunk)
+        return false;
+
+    chunk->next = NULL;
+    chunk->allocated = allocated;
+    chunk->size = 0;
+
+    if (sb->last)
+        sb->last->next = chunk;
+    else
+        sb->first = chunk;
+    sb->last = chunk;
+
+    return true;
+}
+
+bool str_builder_append_c (str_builder_t *sb, const char *cstr, int size)
+{
+    if (size < 0)
+        size = cstr ? (int)strlen (cstr) : 0;
+    if (size == 0)
+        return true;
+
+    str_chunk_t *chunk = sb->last;
+
+    // Fill the tail of current chunk first
+    if (chunk)
+    {
+        int tail = imin (chunk->allocated - chunk->size, size);
+        memcpy (chunk->data + chunk->size, cstr, (size_t)tail);
+        chunk->size += tail;
+        sb->size += tail;
+        cstr += tail;
+        size -= tail;
+
+        if (size == 0)
+            return true;
+    }
+
+    if (!str_builder_grow (sb, size))
+        return false;
+
+    chunk = sb->last;
+    memcpy (chunk->data, cstr, (size_t)size);
+    chunk->size = size;
+    sb->size += size;
+
+    return true;
+}
+
+bool str_builder_append_char (str_builder_t *sb, char c)
+{
+    str_chunk_t *chunk = sb->last;
+    if (!chunk || (chunk->size >= chunk->allocated))
+    {
+        if (!str_builder_grow (sb, 1))
+            return false;
+        chunk = sb->last;
+    }
+
+    chunk->data [chunk->size++] = c;
+    sb->size++;
+
+    return true;
+}
+
+bool str_builder_flatten (str_builder_t *sb, str_t *str)
+{
+    if (!str_init_alloc (str, sb->size))
+        return false;
+
+    char *dst = str->data;
+    for (str_chunk_t *cur = sb->first; cur; cur = cur->next)
+    {
+        memcpy (dst, cur->data, (size_t)cur->size);
+        dst += cur->size;
+    }
+
+    str_builder_done (sb);
+    return true;
+}
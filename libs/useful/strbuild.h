@@ -0,0 +1,97 @@
+/* The Cook project
+ * A string builder for long strings assembled from many pieces
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#ifndef __STRBUILD_H__
+#define __STRBUILD_H__
+
+#include "str.h"
+
+typedef struct _str_chunk_t str_chunk_t;
+
+/**
+ * The string builder collects text into a chain of chunks, every next
+ * chunk twice as large as previous. Unlike appending to a str_t, text
+ * collected so far is never moved or reallocated, and the final string
+ * is assembled just once into a buffer of exactly the required size.
+ */
+typedef struct
+{
+    /// The first chunk in chain
+    str_chunk_t *first;
+    /// The chunk we're appending to
+    str_chunk_t *last;
+    /// Total size of collected text
+    int size;
+} str_builder_t;
+
+/// String builder initializer
+#define STR_BUILDER_INIT    { NULL, NULL, 0 }
+
+/**
+ * Initialize an empty string builder.
+ *
+ * @param sb The string builder object.
+ */
+extern void str_builder_init (str_builder_t *sb);
+
+/**
+ * Free all text collected by the string builder.
+ * The builder may be reused afterwards.
+ *
+ * @param sb The string builder object.
+ */
+extern void str_builder_done (str_builder_t *sb);
+
+/**
+ * Append a piece of memory to the string builder.
+ *
+ * @param sb The string builder object.
+ * @param cstr The text to append.
+ * @param size Text size in bytes or -1 to use strlen()
+ * @return false on memory allocation failure.
+ */
+extern bool str_builder_append_c (str_builder_t *sb, const char *cstr, int size);
+
+/**
+ * Append a string to the string builder.
+ *
+ * @param sb The string builder object.
+ * @param str The string to append.
+ * @return false on memory allocation failure.
+ */
+static inline bool str_builder_append (str_builder_t *sb, const str_t *str)
+{ return str_builder_append_c (sb, str->data, str->size); }
+
+/**
+ * Append a single character to the string builder.
+ *
+ * @param sb The string builder object.
+ * @param c The character to append.
+ * @return false on memory allocation failure.
+ */
+extern bool str_builder_append_char (str_builder_t *sb, char c);
+
+/**
+ * Get the size of text collected so far.
+ *
+ * @param sb The string builder object.
+ * @return Text size in bytes.
+ */
+static inline int str_builder_size (const str_builder_t *sb)
+{ return sb->size; }
+
+/**
+ * Move the collected text into a string object. The string gets
+ * a buffer of exactly the needed size, and the builder becomes empty.
+ *
+ * @param sb The string builder object.
+ * @param str The string to initialize with the collected text.
+ * @return false on memory allocation failure (the builder keeps its text).
+ */
+extern bool str_builder_flatten (str_builder_t *sb, str_t *str);
+
+#endif /* __STRBUILD_H__ */
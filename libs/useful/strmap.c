@@ -0,0 +1,40 @@
+/* The Cook project
+ * A hash map of strings.
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#include "strmap.h"
+
+static void hashmap_str_free (void *item);
+
+static hashmap_vmt_t hashmap_str_vmt =
+{
+    hashmap_str_free,
+    NULL,
+    hashmap_str_hash,
+    hashmap_str_equal,
+};
+
+void hashmap_str_init (hashmap_t *map, int size)
+{
+    hashmap_init (map, &hashmap_str_vmt, size);
+}
+
+static void hashmap_str_free (void *item)
+{
+    str_free (item);
+}
+
+uint64_t hashmap_str_hash (const void *key)
+{
+    const str_t *str = key;
+    // Keys may be constants, so don't try to cache the hash
+    return str->hash ? str->hash : str_hash_c (str->data, str->size);
+}
+
+bool hashmap_str_equal (const void *key1, const void *key2)
+{
+    return str_equal (key1, key2);
+}
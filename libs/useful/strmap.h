@@ -0,0 +1,44 @@
+/* The Cook project
+ * A hash map of strings.
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#ifndef __STRMAP_H__
+#define __STRMAP_H__
+
+#include "hashmap.h"
+#include "str.h"
+
+/**
+ * Initialize a hash map of str_t* elements, freeable with str_free().
+ * The strings themselves are the keys, so str_t* is passed as key
+ * to hashmap_get() and friends. Cached string hashes are used
+ * when available.
+ *
+ * @param map The hash map to initialize.
+ * @param size Estimated number of elements in the hash map.
+ */
+extern void hashmap_str_init (hashmap_t *map, int size);
+
+/**
+ * A hash() method for str_t* keys, suitable for custom hash maps
+ * with string keys.
+ *
+ * @param key A str_t* key.
+ * @return The string hash.
+ */
+extern uint64_t hashmap_str_hash (const void *key);
+
+/**
+ * A equal() method for str_t* keys, suitable for custom hash maps
+ * with string keys.
+ *
+ * @param key1 The first str_t* key.
+ * @param key2 The second str_t* key.
+ * @return true if strings are equal.
+ */
+extern bool hashmap_str_equal (const void *key1, const void *key2);
+
+#endif /* __STRMAP_H__ */
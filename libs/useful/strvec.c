@@ -7,17 +7,26 @@
 
 #include "strvec.h"
 
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
+// Buckets this small are sorted by insertion
+#define STRVEC_RADIX_INSERTION  32
+// Buckets nested deeper than this are merge sorted, to bound the stack
+#define STRVEC_RADIX_LEVELS     64
+
 static void vector_str_free (void *item);
 static int vector_str_compare (const void *item1, const void *item2);
 static int vector_str_compare_key (const void *item, const void *key);
+static bool vector_str_sort (void **data, int size, bool stable);
 
 static vector_vmt_t vector_str_vmt =
 {
     vector_str_free,
     vector_str_compare,
     vector_str_compare_key,
+    vector_str_sort,
 };
 
 void vector_str_init (vector_t *vec, int size)
@@ -51,3 +60,155 @@ static int vector_str_compare_key (const void *item, const void *key)
 {
     return str_cmp (item, (str_t *)key);
 }
+
+/* Compare two strings which are known to have same first depth bytes.
+ */
+static inline int vector_str_compare_tail (const str_t *str1, const str_t *str2, int depth)
+{
+    int ml = imin (str1->size, str2->size) - depth;
+    if (ml > 0)
+    {
+        int res = memcmp (str1->data + depth, str2->data + depth, (size_t)ml);
+        if (res != 0)
+            return res;
+    }
+
+    return str1->size - str2->size;
+}
+
+// The bucket of a string at given depth: 0 if string ended, byte + 1 otherwise
+static inline int vector_str_bucket (const str_t *str, int depth)
+{
+    return (depth < str->size) ? (unsigned char)str->data [depth] + 1 : 0;
+}
+
+// Stable insertion sort for strings with same first depth bytes
+static void vector_str_insertion (str_t **data, int size, int depth)
+{
+    for (int i = 1; i < size; i++)
+    {
+        str_t *item = data [i];
+        int j = i;
+        for (; (j > 0) && (vector_str_compare_tail (data [j - 1], item, depth) > 0); j--)
+            data [j] = data [j - 1];
+        data [j] = item;
+    }
+}
+
+/* Stable bottom-up merge sort for strings with same first depth bytes.
+ * Runs of STRVEC_RADIX_INSERTION strings are sorted by insertion, then
+ * merged back and forth between data and tmp.
+ */
+static void vector_str_merge (str_t **data, str_t **tmp, int size, int depth)
+{
+    for (int i = 0; i < size; i += STRVEC_RADIX_INSERTION)
+        vector_str_insertion (data + i, imin (STRVEC_RADIX_INSERTION, size - i), depth);
+
+    str_t **src = data, **dst = tmp;
+    for (int width = STRVEC_RADIX_INSERTION; width < size; width *= 2)
+    {
+        for (int lo = 0; lo < size; lo += 2 * width)
+        {
+            int mid = imin (lo + width, size), hi = imin (lo + 2 * width, size);
+            int i = lo, j = mid, k = lo;
+            while ((i < mid) && (j < hi))
+                dst [k++] = (vector_str_compare_tail (src [j], src [i], depth) < 0) ?
+                    src [j++] : src [i++];
+            while (i < mid)
+                dst [k++] = src [i++];
+            while (j < hi)
+                dst [k++] = src [j++];
+        }
+
+        str_t **swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != data)
+        memcpy (data, src, (size_t)size * sizeof (str_t *));
+}
+
+/* MSD radix sort. Strings are distributed into buckets by the byte at
+ * given depth with a (stable) counting sort, then every bucket is sorted
+ * by the next byte. Long common prefixes, typical for file lists, are
+ * skipped without any comparisons at all. Keys nested in each other
+ * ("a", "aa", "aaa"...) would recurse once per byte, so buckets nested
+ * deeper than STRVEC_RADIX_LEVELS are merge sorted instead.
+ */
+static void vector_str_radix (str_t **data, str_t **tmp, int size, int depth, int level)
+{
+    while (size > STRVEC_RADIX_INSERTION)
+    {
+        if (level >= STRVEC_RADIX_LEVELS)
+        {
+            vector_str_merge (data, tmp, size, depth);
+            return;
+        }
+
+        int count [258];
+        memset (count, 0, sizeof (count));
+
+        for (int i = 0; i < size; i++)
+            count [vector_str_bucket (data [i], depth) + 1]++;
+
+        // All strings have the same byte here, go deeper
+        int b0 = vector_str_bucket (data [0], depth);
+        if (count [b0 + 1] == size)
+        {
+            if (b0 == 0)
+                return;
+            depth++;
+            continue;
+        }
+
+        for (int b = 1; b < 258; b++)
+            count [b] += count [b - 1];
+
+        for (int i = 0; i < size; i++)
+            tmp [count [vector_str_bucket (data [i], depth)]++] = data [i];
+        memcpy (data, tmp, (size_t)size * sizeof (str_t *));
+
+        // Now count [b] is the end of bucket b; bucket 0 (ended strings)
+        // contains equal strings, so it is already sorted
+        for (int b = 1; b < 257; b++)
+        {
+            int start = count [b - 1];
+            if (count [b] - start > 1)
+                vector_str_radix (data + start, tmp, count [b] - start, depth + 1, level + 1);
+        }
+        return;
+    }
+
+    vector_str_insertion (data, size, depth);
+}
+
+static bool vector_str_sort (void **data, int size, bool stable)
+{
+    // The radix sort is always stable
+    (void)stable;
+
+    str_t **tmp = malloc ((size_t)size * sizeof (str_t *));
+    if (!tmp)
+        return false;
+
+    // NULLs go first, as str_cmp() says
+    int nulls = 0, strs = 0;
+    for (int i = 0; i < size; i++)
+        if (data [i])
+            tmp [strs++] = data [i];
+        else
+            nulls++;
+
+    if (nulls)
+    {
+        for (int i = 0; i < nulls; i++)
+            data [i] = NULL;
+        memcpy (data + nulls, tmp, (size_t)strs * sizeof (str_t *));
+    }
+
+    vector_str_radix ((str_t **)data + nulls, tmp, strs, 0, 0);
+
+    free (tmp);
+    return true;
+}
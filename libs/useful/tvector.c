@@ -0,0 +1,33 @@
+/* The Cook project
+ * Typed vectors storing elements by value
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#include "tvector.h"
+
+#include <limits.h>
+
+bool tvector_allocate (void **data, int *allocated, int size, size_t item_size)
+{
+    if (size <= *allocated)
+        return true;
+
+    // Grow geometrically, but don't bother with less than 8 elements
+    int new_allocated = *allocated ? *allocated : 8;
+    while (new_allocated < size)
+    {
+        if (new_allocated > INT_MAX / 2)
+            return false;
+        new_allocated *= 2;
+    }
+
+    void *new_data = realloc (*data, (size_t)new_allocated * item_size);
+    if (!new_data)
+        return false;
+
+    *data = new_data;
+    *allocated = new_allocated;
+    return true;
+}
@@ -0,0 +1,181 @@
+/* The Cook project
+ * Typed vectors storing elements by value
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#ifndef __TVECTOR_H__
+#define __TVECTOR_H__
+
+#include "useful.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Make sure a typed vector may hold at least @a size elements.
+ * This is the common part of all typed vectors, don't call it directly.
+ *
+ * @param data A pointer to vector data pointer.
+ * @param allocated A pointer to the number of allocated elements.
+ * @param size Required number of elements.
+ * @param item_size The size of a element in bytes.
+ * @return false on memory allocation failure (vector is left intact).
+ */
+extern bool tvector_allocate (void **data, int *allocated, int size, size_t item_size);
+
+/**
+ * Define a vector type which stores elements of given type by value,
+ * contiguously in memory, together with the functions to handle it.
+ * Unlike vector_t, elements don't need to be allocated one by one
+ * and iterating over them doesn't chase pointers all over the heap.
+ *
+ * Elements are moved in memory as the vector grows, so don't keep
+ * pointers to elements across insertions. The vector doesn't know
+ * how to free the elements, so finalize them before calling xxx_done().
+ *
+ * For example, VECTOR_DEFINE (vector_int, int) defines the type
+ * vector_int_t and functions vector_int_init(), vector_int_append()
+ * and so on. Usually the macro is used in a header file.
+ *
+ * @param name The prefix for the type and function names.
+ * @param type The type of vector elements.
+ */
+#define VECTOR_DEFINE(name, type) \
+\
+typedef struct \
+{ \
+    /* Vector elements */ \
+    type *data; \
+    /* Number of elements in the vector */ \
+    int size; \
+    /* Number of allocated elements */ \
+    int allocated; \
+} name##_t; \
+\
+/* Initialize a empty vector */ \
+static inline void name##_init (name##_t *vec) \
+{ vec->data = NULL; vec->size = vec->allocated = 0; } \
+\
+/* Free the memory used by vector (but not the elements!) */ \
+static inline void name##_done (name##_t *vec) \
+{ free (vec->data); name##_init (vec); } \
+\
+/* Remove all elements, keeping the memory */ \
+static inline void name##_clear (name##_t *vec) \
+{ vec->size = 0; } \
+\
+/* Make sure vector may hold size elements without reallocations */ \
+static inline bool name##_reserve (name##_t *vec, int size) \
+{ \
+    return (size <= vec->allocated) || \
+        tvector_allocate ((void **)&vec->data, &vec->allocated, size, sizeof (type)); \
+} \
+\
+/* Get a pointer to the element at pos, or NULL if out of range */ \
+static inline type *name##_get (const name##_t *vec, int pos) \
+{ return ((pos >= 0) && (pos < vec->size)) ? vec->data + pos : NULL; } \
+\
+/* Insert a uninitialized element at pos, return a pointer to it */ \
+static inline type *name##_insert_empty (name##_t *vec, int pos) \
+{ \
+    if ((pos < 0) || (pos > vec->size) || !name##_reserve (vec, vec->size + 1)) \
+        return NULL; \
+    memmove (vec->data + pos + 1, vec->data + pos, \
+             (size_t)(vec->size - pos) * sizeof (type)); \
+    vec->size++; \
+    return vec->data + pos; \
+} \
+\
+/* Insert a copy of item at pos (item may point into the vector itself, \
+   so it is copied before the elements may move) */ \
+static inline bool name##_insert (name##_t *vec, int pos, const type *item) \
+{ \
+    type copy = *item; \
+    type *dst = name##_insert_empty (vec, pos); \
+    if (dst) \
+        *dst = copy; \
+    return dst != NULL; \
+} \
+\
+/* Append a uninitialized element, return a pointer to it */ \
+static inline type *name##_push (name##_t *vec) \
+{ \
+    if (!name##_reserve (vec, vec->size + 1)) \
+        return NULL; \
+    return vec->data + vec->size++; \
+} \
+\
+/* Append a copy of item to the end of vector (item may point \
+   into the vector itself) */ \
+static inline bool name##_append (name##_t *vec, const type *item) \
+{ \
+    type copy = *item; \
+    type *dst = name##_push (vec); \
+    if (dst) \
+        *dst = copy; \
+    return dst != NULL; \
+} \
+\
+/* Remove the last element and copy it to item (if not NULL) */ \
+static inline bool name##_pop (name##_t *vec, type *item) \
+{ \
+    if (vec->size <= 0) \
+        return false; \
+    vec->size--; \
+    if (item) \
+        *item = vec->data [vec->size]; \
+    return true; \
+} \
+\
+/* Delete count elements starting at pos */ \
+static inline bool name##_delete (name##_t *vec, int pos, int count) \
+{ \
+    if ((pos < 0) || (count < 0) || (pos + count > vec->size)) \
+        return false; \
+    memmove (vec->data + pos, vec->data + pos + count, \
+             (size_t)(vec->size - pos - count) * sizeof (type)); \
+    vec->size -= count; \
+    return true; \
+} \
+\
+/* Binary search in a sorted vector. Returns the index of element found, \
+   or -(insertion point) - 1 if there's no element with such key */ \
+static inline int name##_search (const name##_t *vec, const void *key, \
+    int (*compare_key) (const type *item, const void *key)) \
+{ \
+    int l = 0, r = vec->size - 1; \
+    while (l <= r) \
+    { \
+        int m = (l + r) / 2; \
+        int cmp = compare_key (vec->data + m, key); \
+        if (cmp == 0) \
+            return m; \
+        else if (cmp < 0) \
+            l = m + 1; \
+        else \
+            r = m - 1; \
+    } \
+    return -l - 1; \
+} \
+\
+/* Find a element in a sorted vector, returns its index or -1 */ \
+static inline int name##_find_sorted (const name##_t *vec, const void *key, \
+    int (*compare_key) (const type *item, const void *key)) \
+{ \
+    int pos = name##_search (vec, key, compare_key); \
+    return (pos >= 0) ? pos : -1; \
+} \
+\
+/* Insert a copy of item into a sorted vector, returns its index or -1 */ \
+static inline int name##_insert_sorted (name##_t *vec, const type *item, \
+    int (*compare_key) (const type *item, const void *key)) \
+{ \
+    int pos = name##_search (vec, item, compare_key); \
+    if (pos < 0) \
+        pos = -pos - 1; \
+    return name##_insert (vec, pos, item) ? pos : -1; \
+}
+
+#endif /* __TVECTOR_H__ */
@@ -7,6 +7,8 @@
 
 #include "useful.h"
 
+#include <string.h>
+
 unsigned fls32 (uint32_t bits)
 {
     unsigned r = 0;
@@ -17,3 +19,44 @@ unsigned fls32 (uint32_t bits)
     if (bits & 0x00000002) { r +=  1;              }
     return r;
 }
+
+static inline uint64_t rotl64 (uint64_t x, int n)
+{
+    return (x << n) | (x >> (64 - n));
+}
+
+// The finalization mix from MurmurHash3, forces all bits to avalanche
+static inline uint64_t fmix64 (uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+uint64_t hash64 (const void *data, size_t size, uint64_t seed)
+{
+    const uint8_t *cur = data;
+    uint64_t h = seed ^ (size * 0x9e3779b97f4a7c15ULL);
+    uint64_t v;
+
+    // Eat 8 bytes at a time
+    for (; size >= 8; cur += 8, size -= 8)
+    {
+        memcpy (&v, cur, 8);
+        h ^= rotl64 (v * 0x87c37b91114253d5ULL, 31) * 0x4cf5ad432745937fULL;
+        h = rotl64 (h, 27) * 5 + 0x52dce729;
+    }
+
+    // and the tail, if any
+    if (size)
+    {
+        v = 0;
+        memcpy (&v, cur, size);
+        h ^= rotl64 (v * 0x87c37b91114253d5ULL, 31) * 0x4cf5ad432745937fULL;
+    }
+
+    return fmix64 (h);
+}
@@ -9,6 +9,7 @@
 #define __USEFUL_H__
 
 #include <stdint.h>
+#include <stddef.h>
 
 /// Get the number of elements in a static array
 #define ARRAY_LEN(x)		(sizeof (x) / sizeof (x [0]))
@@ -27,6 +28,20 @@ typedef enum { false = 0, true = !false } bool;
  */
 extern unsigned fls32 (uint32_t bits);
 
+/**
+ * Compute a 64-bit hash of a memory block.
+ * The hash is fast and has good distribution, but is not cryptographic.
+ * @param data
+ *      A pointer to data to hash.
+ * @param size
+ *      Data size in bytes.
+ * @param seed
+ *      Initial hash value, use different seeds to get different hashes.
+ * @return
+ *      The hash value.
+ */
+extern uint64_t hash64 (const void *data, size_t size, uint64_t seed);
+
 /**
  * Return the minimum of two integers
  * @param x first number
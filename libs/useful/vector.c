@@ -64,10 +64,10 @@ void vector_done (vector_t *vec)
     vector_clear (vec);
 
     if (vec->allocated)
-    {
         free (vec->data);
-        vec->allocated = 0;
-    }
+
+    vec->data = NULL;
+    vec->allocated = 0;
 }
 
 void vector_free (vector_t *vec)
@@ -272,77 +272,243 @@ bool vector_exchange (vector_t *vec, int pos1, int pos2)
     return true;
 }
 
-static void vector_qsort_i (vector_t *vec, int left, int right)
+// Arrays this small are sorted by insertion
+#define VECTOR_SORT_INSERTION   24
+// Give up partial insertion sort after this many element moves
+#define VECTOR_SORT_PARTIAL     8
+
+typedef int (*vector_compare_t) (const void *item1, const void *item2);
+
+static inline void vector_swap (void **data, int pos1, int pos2)
 {
-    int i, j, x;
+    void *tmp = data [pos1];
+    data [pos1] = data [pos2];
+    data [pos2] = tmp;
+}
 
-recurse:
-    i = left;
-    j = right;
-    x = (left + right) / 2;
-    do
+// Stable insertion sort
+static void vector_sort_insertion (void **data, int size, vector_compare_t compare)
+{
+    for (int i = 1; i < size; i++)
     {
-        while ((i != x) && (vec->vmt->compare (vec->data [i], vec->data [x]) < 0))
-            i++;
-        while ((j != x) && (vec->vmt->compare (vec->data [j], vec->data [x]) > 0))
-            j--;
+        void *item = data [i];
+        int j = i;
+        for (; (j > 0) && (compare (data [j - 1], item) > 0); j--)
+            data [j] = data [j - 1];
+        data [j] = item;
+    }
+}
 
-        if (i < j)
-        {
-            // we're guaranteed i and j are within vector boundaries
-            vector_exchange_i (vec, i, j);
+/* Try to sort an almost sorted array by insertion.
+ * Gives up and returns false if too many elements had to be moved.
+ */
+static bool vector_sort_partial (void **data, int size, vector_compare_t compare)
+{
+    int moves = 0;
+    for (int i = 1; i < size; i++)
+    {
+        void *item = data [i];
+        int j = i;
+        for (; (j > 0) && (compare (data [j - 1], item) > 0); j--)
+            data [j] = data [j - 1];
+        data [j] = item;
+
+        moves += i - j;
+        if (moves > VECTOR_SORT_PARTIAL)
+            return false;
+    }
+
+    return true;
+}
+
+static void vector_sift_down (void **data, int root, int size, vector_compare_t compare)
+{
+    void *item = data [root];
+    for (;;)
+    {
+        int child = root * 2 + 1;
+        if (child >= size)
+            break;
+        if ((child + 1 < size) && (compare (data [child], data [child + 1]) < 0))
+            child++;
+        if (compare (item, data [child]) >= 0)
+            break;
+        data [root] = data [child];
+        root = child;
+    }
+    data [root] = item;
+}
+
+// The last resort which guarantees O(n*log(n))
+static void vector_sort_heap (void **data, int size, vector_compare_t compare)
+{
+    for (int i = size / 2 - 1; i >= 0; i--)
+        vector_sift_down (data, i, size, compare);
+
+    for (int i = size - 1; i > 0; i--)
+    {
+        vector_swap (data, 0, i);
+        vector_sift_down (data, 0, i, compare);
+    }
+}
+
+// Put the median of three elements into the middle one
+static inline void vector_sort3 (void **data, int a, int b, int c,
+                                 vector_compare_t compare)
+{
+    if (compare (data [b], data [a]) < 0)
+        vector_swap (data, a, b);
+    if (compare (data [c], data [b]) < 0)
+    {
+        vector_swap (data, b, c);
+        if (compare (data [b], data [a]) < 0)
+            vector_swap (data, a, b);
+    }
+}
 
-            if (x == i)
-                x = j;
-            else if (x == j)
-                x = i;
+/* Introspective sort: quicksort with a median-of-three (or ninther)
+ * pivot, switching to heapsort if recursion gets too deep. Like in
+ * pdqsort, if a partitioning did not move anything, the input is likely
+ * to be sorted already, so we try to finish the job by insertion.
+ */
+static void vector_sort_intro (void **data, int size, vector_compare_t compare, int depth)
+{
+    while (size > VECTOR_SORT_INSERTION)
+    {
+        if (depth-- <= 0)
+        {
+            vector_sort_heap (data, size, compare);
+            return;
         }
 
-        if (i <= j)
+        // Choose the pivot and move it to data [0]
+        int mid = size / 2;
+        if (size > 128)
+        {
+            int e = size / 8;
+            vector_sort3 (data, 1, e, 2 * e, compare);
+            vector_sort3 (data, mid - e, mid, mid + e, compare);
+            vector_sort3 (data, size - 1 - 2 * e, size - 1 - e, size - 2, compare);
+            vector_sort3 (data, e, mid, size - 1 - e, compare);
+        }
+        else
+            vector_sort3 (data, 0, mid, size - 1, compare);
+        vector_swap (data, 0, mid);
+
+        // Partition, stopping at equal elements, so that
+        // lots of equal elements split evenly
+        void *pivot = data [0];
+        int i = 0, j = size;
+        bool swapped = false;
+        for (;;)
         {
-            i++;
-            if (j > left)
-                j--;
+            while ((++i < size - 1) && (compare (data [i], pivot) < 0))
+                ;
+            while (compare (pivot, data [--j]) < 0)
+                ;
+            if (i >= j)
+                break;
+            vector_swap (data, i, j);
+            swapped = true;
         }
-    } while (i <= j);
+        vector_swap (data, 0, j);
 
-    if (j - left < right - i)
-    {
-        if (left < j)
-            vector_qsort_i (vec, left, j);
+        int left = j, right = size - j - 1;
+        if (!swapped &&
+            vector_sort_partial (data, left, compare) &&
+            vector_sort_partial (data + j + 1, right, compare))
+            return;
 
-        if (i < right)
+        // Recurse into the smaller part, loop on the larger one
+        if (left < right)
         {
-            left = i;
-            goto recurse;
+            vector_sort_intro (data, left, compare, depth);
+            data += j + 1;
+            size = right;
         }
-    }
-    else
-    {
-        if (i < right)
-            vector_qsort_i (vec, i, right);
-
-        if (left < j)
+        else
         {
-            right = j;
-            goto recurse;
+            vector_sort_intro (data + j + 1, right, compare, depth);
+            size = left;
         }
     }
+
+    vector_sort_insertion (data, size, compare);
 }
 
-bool vector_qsort (vector_t *vec)
+// Merge sort, tmp must hold size / 2 elements
+static void vector_sort_merge (void **data, void **tmp, int size, vector_compare_t compare)
+{
+    if (size <= VECTOR_SORT_INSERTION)
+    {
+        vector_sort_insertion (data, size, compare);
+        return;
+    }
+
+    int half = size / 2;
+    vector_sort_merge (data, tmp, half, compare);
+    vector_sort_merge (data + half, tmp, size - half, compare);
+
+    // Already in order?
+    if (compare (data [half - 1], data [half]) <= 0)
+        return;
+
+    memcpy (tmp, data, (size_t)half * sizeof (void *));
+
+    int i = 0, j = half, k = 0;
+    while ((i < half) && (j < size))
+        data [k++] = (compare (data [j], tmp [i]) < 0) ? data [j++] : tmp [i++];
+    while (i < half)
+        data [k++] = tmp [i++];
+}
+
+bool vector_sort (vector_t *vec)
 {
     assert (vec);
 
     if (!vec->vmt || !vec->vmt->compare)
         return false;
 
-    if (vec->size)
-        vector_qsort_i (vec, 0, vec->size - 1);
+    if (vec->size < 2)
+        return true;
+
+    // Prefer the type-specific sort, if there's one
+    if (vec->vmt->sort && vec->vmt->sort (vec->data, vec->size, false))
+        return true;
 
+    vector_sort_intro (vec->data, vec->size, vec->vmt->compare,
+                       2 * (int)fls32 ((uint32_t)vec->size));
     return true;
 }
 
+bool vector_sort_stable (vector_t *vec)
+{
+    assert (vec);
+
+    if (!vec->vmt || !vec->vmt->compare)
+        return false;
+
+    if (vec->size < 2)
+        return true;
+
+    if (vec->vmt->sort && vec->vmt->sort (vec->data, vec->size, true))
+        return true;
+
+    void **tmp = malloc ((size_t)(vec->size / 2) * sizeof (void *));
+    if (!tmp)
+        return false;
+
+    vector_sort_merge (vec->data, tmp, vec->size, vec->vmt->compare);
+
+    free (tmp);
+    return true;
+}
+
+bool vector_qsort (vector_t *vec)
+{
+    return vector_sort (vec);
+}
+
 int vector_insert_sorted (vector_t *vec, void *item)
 {
     assert (vec);
@@ -374,6 +540,85 @@ int vector_insert_sorted (vector_t *vec, void *item)
     return m;
 }
 
+bool vector_insert_sorted_bulk (vector_t *vec, vector_t *batch, vector_dup_t dup)
+{
+    assert (vec && batch);
+
+    if (!vec->vmt || !vec->vmt->compare)
+        return false;
+
+    if (batch->size == 0)
+        return true;
+
+    // Sort the batch the same way as the vector, keeping the order
+    // of duplicates, so that we know which of them comes last
+    const vector_vmt_t *batch_vmt = batch->vmt;
+    batch->vmt = vec->vmt;
+    bool ok = vector_sort_stable (batch);
+    batch->vmt = batch_vmt;
+    if (!ok)
+        return false;
+
+    int (*compare) (const void *, const void *) = vec->vmt->compare;
+    void (*free_item) (void *) = vec->vmt->free;
+
+    int allocated = vector_alloc_size (vec->size + batch->size);
+    void **data = malloc ((size_t)allocated * sizeof (void *));
+    if (!data)
+        return false;
+
+    /* Merge into the new array. Elements which lose to duplicates are
+     * collected at the start of the batch: there are never more of them
+     * than batch elements consumed so far, so we don't overwrite anything
+     * still needed. They are freed only when we know we've succeeded.
+     */
+    int i = 0, j = 0, size = 0, losers = 0;
+    while ((i < vec->size) || (j < batch->size))
+    {
+        // Vector elements go first, even duplicates already in the vector
+        if ((j >= batch->size) ||
+            ((i < vec->size) && (compare (batch->data [j], vec->data [i]) >= 0)))
+        {
+            data [size++] = vec->data [i++];
+            continue;
+        }
+
+        void *item = batch->data [j++];
+
+        if ((size > 0) && (compare (data [size - 1], item) == 0))
+        {
+            if (dup == VECTOR_DUP_REJECT)
+            {
+                free (data);
+                return false;
+            }
+
+            if (dup == VECTOR_DUP_REPLACE)
+            {
+                batch->data [losers++] = data [size - 1];
+                data [size - 1] = item;
+            }
+            else
+                batch->data [losers++] = item;
+            continue;
+        }
+
+        data [size++] = item;
+    }
+
+    if (free_item)
+        for (j = 0; j < losers; j++)
+            free_item (batch->data [j]);
+
+    free (vec->data);
+    vec->data = data;
+    vec->size = size;
+    vec->allocated = allocated;
+    batch->size = 0;
+
+    return true;
+}
+
 int vector_find_sorted (vector_t *vec, void *item)
 {
     assert (vec);
@@ -34,6 +34,16 @@ typedef struct
      * to sort the array.
      */
     int (*compare_key) (const void *item, const void *key);
+
+    /**
+     * Sort an array of elements in a type-specific way (may be NULL).
+     * The result must be the same as sorting with compare() would give.
+     * @param data The array of elements.
+     * @param size The number of elements in the array.
+     * @param stable true if equal elements must keep their order.
+     * @return false if sorting failed (the generic sort is used then).
+     */
+    bool (*sort) (void **data, int size, bool stable);
 } vector_vmt_t;
 
 /**
@@ -211,8 +221,28 @@ extern bool vector_delete (vector_t *vec, int pos, int count);
 extern bool vector_exchange (vector_t *vec, int pos1, int pos2);
 
 /**
- * Sort the vector using the quicksort algorithm.
- * This uses the 'compare' method which must be defined.
+ * Sort the vector. This uses the type-specific 'sort' method if it is
+ * defined, otherwise a introsort (quicksort which falls back to heapsort
+ * on bad input) is done with the 'compare' method which must be defined.
+ * Sorting takes O(n*log(n)) in the worst case and about O(n) if the
+ * vector is already sorted. Order of equal elements is not preserved.
+ *
+ * @param vec The vector to sort.
+ * @return false if vector sorting failed.
+ */
+extern bool vector_sort (vector_t *vec);
+
+/**
+ * Sort the vector, keeping equal elements in their original order.
+ * This is a merge sort, which needs some temporary memory.
+ *
+ * @param vec The vector to sort.
+ * @return false if vector sorting failed (the vector is left unchanged).
+ */
+extern bool vector_sort_stable (vector_t *vec);
+
+/**
+ * Sort the vector (an old name for vector_sort()).
  *
  * @param vec The vector to sort.
  * @return false if vector sorting failed.
@@ -231,6 +261,43 @@ extern bool vector_qsort (vector_t *vec);
  */
 extern int vector_insert_sorted (vector_t *vec, void *item);
 
+/**
+ * What to do when a element being inserted into a sorted vector
+ * has a key equal to the key of a element already in the vector.
+ */
+typedef enum
+{
+    /// The new element replaces the old one, which is freed
+    VECTOR_DUP_REPLACE,
+    /// The old element stays, the new one is freed
+    VECTOR_DUP_KEEP,
+    /// Duplicates are not allowed, the insertion fails
+    VECTOR_DUP_REJECT,
+} vector_dup_t;
+
+/**
+ * Insert a batch of elements into a sorted vector, maintaining sorting
+ * order. The batch is sorted once and merged with the vector in a single
+ * pass, so inserting m elements into a vector of n elements takes
+ * O(n + m*log(m)) time instead of O(n*m) with vector_insert_sorted().
+ *
+ * Elements with equal keys inside the batch are handled by the same
+ * policy as duplicates of vector elements, as if batch elements were
+ * inserted one by one in their original order.
+ * This uses the 'compare' method which must be defined.
+ *
+ * @param vec The sorted vector to insert into.
+ * @param batch The elements to insert, in any order. On success all
+ *     elements are moved to vec (or freed), and the batch becomes empty.
+ *     If insertion fails the batch keeps all its elements, although
+ *     their order may change.
+ * @param dup What to do with elements having duplicate keys.
+ * @return false on memory allocation failure or if dup is
+ *     VECTOR_DUP_REJECT and a duplicate key was found; the vector
+ *     is left unchanged in this case.
+ */
+extern bool vector_insert_sorted_bulk (vector_t *vec, vector_t *batch, vector_dup_t dup);
+
 /**
  * Quickly find a element in a sorted vector using binary search.
  *
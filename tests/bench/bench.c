@@ -0,0 +1,298 @@
+/* The Cook project
+ * Common code for tokenizer and parser benchmarks
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#include "bench.h"
+#include "strbuild.h"
+#include "intern.h"
+#include "rand.h"
+#include "var.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// Statement templates, %d is replaced by a unique number
+static const char *flat_templates [] =
+{
+    "VAR%d = value aa bbb ccc\n",
+    "VAR%d += value\n  spanning\n  several\n  lines\n",
+    "# comment line number %d with some words\n",
+    "VAR%d ?= ${VAR1} ${VAR2} $X\n",
+    "VAR%d -= ${math 1+1*VAR2}\n",
+    "info $.ENV.PATH%d\n",
+    "T%d=${CTX.FULL}.tokenizer\n",
+};
+
+static const char *nested_templates [] =
+{
+    "func%d = {\n    A = ${wildcard $1}\n    info $A\n        B\n}\n",
+    "${func%d aaa bbb\n    , A = ccc\n        ddd\n    , B = eee\n}\n",
+    "iter%d = {\n    $1 = $2\n    4 ?= 1\n    5 = ${if ${math $4 < 0} > <}\n"
+    "    {\n        if ${math $1 $5 $3} {\n            $1 = ${math $1 + $4}\n"
+    "            true\n        }\n    }\n}\n",
+    "struct T%d\n    ,SRC = ${wildcard tests/*/*.c}\n",
+    "B%d = Q {$A $gen} W\n",
+};
+
+/* The parser grammar does not handle everything the tokenizer does yet
+ * (comment lines, continuation lines, indented blocks, unveils without
+ * arguments), so the parser benchmark uses only these templates.
+ */
+static const char *flat_parse_templates [] =
+{
+    "VAR%d = value aa bbb ccc\n",
+    "VAR%d = value aa bbb ccc # comment\n",
+    "VAR%d ?= ${VAR1 x} ${VAR2 y} $X\n",
+    "VAR%d -= ${math 1+1*VAR2}\n",
+    "info $.ENV.PATH%d\n",
+    "T%d=${CTX.FULL x}.tokenizer\n",
+};
+
+static const char *nested_parse_templates [] =
+{
+    "func%d = {A = ${wildcard $1 x}\ninfo $A\n}\n",
+    "X%d = {info ${wildcard a b} c\n}\n",
+    "iter%d = {$1 = $2\n4 ?= 1\n5 = ${if ${math $4 < 0} > <}\n}\n",
+    "X%d = {Y = {Z = a\n}\n}\n",
+    "B%d = Q {$A $gen\n} W\n",
+};
+
+static const char *strings_templates [] =
+{
+    "VAR%d = \"test\nstring\nspanning\nmultiple\nlines\"\n",
+    "VAR%d = one\" two \"three\n",
+    "VAR\\.%d = abc\n",
+    "VAR%d+\\= = \"string containing \"\" double quote\"\n",
+    "\"STRANGE VAR NAME %d\"\\n = \"\"\"strange\"\" \"\"string\"\"\"\n",
+    "info Unicode entities: [\\u120171;\\x1D56B;] %d\n",
+};
+
+static const struct
+{
+    const char *name;
+    // All templates, and the ones the parser accepts
+    const char **templates, **parse_templates;
+    int count, parse_count;
+} shapes [BENCH_SHAPES] =
+{
+    [BENCH_FLAT] = { "flat", flat_templates, flat_parse_templates,
+        ARRAY_LEN (flat_templates), ARRAY_LEN (flat_parse_templates) },
+    [BENCH_NESTED] = { "nested", nested_templates, nested_parse_templates,
+        ARRAY_LEN (nested_templates), ARRAY_LEN (nested_parse_templates) },
+    // all string templates are accepted by the parser
+    [BENCH_STRINGS] = { "strings", strings_templates, strings_templates,
+        ARRAY_LEN (strings_templates), ARRAY_LEN (strings_templates) },
+    // picks a shape for every statement
+    [BENCH_MIXED] = { "mixed", NULL, NULL, 0, 0 },
+};
+
+// Default text sizes, the last one is the largest
+static const int default_sizes [] = { 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+#define BENCH_MAX_SIZES 16
+
+void bench_recipe (str_t *text, bench_shape_t shape, int size, bool parse)
+{
+    rand_state_t rs;
+    rand_init (&rs, shape);
+
+    str_builder_t sb;
+    str_builder_init (&sb);
+
+    for (int i = 0; str_builder_size (&sb) < size; i++)
+    {
+        bench_shape_t s = shape;
+        if (s == BENCH_MIXED)
+            s = (bench_shape_t)rand_range (&rs, BENCH_MIXED);
+
+        const char **templates = parse ? shapes [s].parse_templates : shapes [s].templates;
+        int count = parse ? shapes [s].parse_count : shapes [s].count;
+
+        char line [256];
+        int len = snprintf (line, sizeof (line), templates [rand_range (&rs, (uint32_t)count)], i);
+        assert ((len > 0) && (len < (int)sizeof (line)));
+        assert (str_builder_append_c (&sb, line, len));
+
+        // An empty line now and then
+        if (rand_range (&rs, 8) == 0)
+            assert (str_builder_append_char (&sb, '\n'));
+    }
+
+    assert (str_builder_flatten (&sb, text));
+    str_builder_done (&sb);
+}
+
+// The number of heap allocations, counted by the wrappers below
+static atomic_long bench_allocs;
+
+extern void *__real_malloc (size_t size);
+extern void *__real_calloc (size_t count, size_t size);
+extern void *__real_realloc (void *ptr, size_t size);
+
+void *__wrap_malloc (size_t size)
+{
+    atomic_fetch_add_explicit (&bench_allocs, 1, memory_order_relaxed);
+    return __real_malloc (size);
+}
+
+void *__wrap_calloc (size_t count, size_t size)
+{
+    atomic_fetch_add_explicit (&bench_allocs, 1, memory_order_relaxed);
+    return __real_calloc (count, size);
+}
+
+void *__wrap_realloc (void *ptr, size_t size)
+{
+    atomic_fetch_add_explicit (&bench_allocs, 1, memory_order_relaxed);
+    return __real_realloc (ptr, size);
+}
+
+long bench_alloc_count ()
+{
+    return atomic_load_explicit (&bench_allocs, memory_order_relaxed);
+}
+
+// Run a single mode over a single recipe, in a child process
+static int bench_child (const char *bench, const char *output, const char *label,
+                        bench_shape_t shape, int size, const bench_mode_t *mode)
+{
+    str_t text;
+    bench_recipe (&text, shape, size, mode->parse);
+
+    // Small texts run more times to get stable results
+    int loops = imin (100, imax (5, default_sizes [ARRAY_LEN (default_sizes) - 1] / size));
+
+    bench_run_t best = { 0, 0, 0, 0 };
+    for (int i = 0; i < loops; i++)
+    {
+        // Start with empty symbol table every time
+        var_done_root_ctx ();
+        str_intern_finalize ();
+
+        bench_run_t run = { 0, 0, 0, 0 };
+        mode->run (&text, &run);
+        if ((i == 0) || (run.time < best.time))
+            best = run;
+    }
+
+    struct rusage ru;
+    getrusage (RUSAGE_SELF, &ru);
+
+    double mbps = text.size / best.time / 1e6;
+    double mtps = best.tokens / best.time / 1e6;
+    printf ("%-8s %9d %-7s %8.1f %9.2f %10ld %8ld %7d %9ld\n",
+            shapes [shape].name, text.size, mode->name, mbps, mtps,
+            best.tokens, best.allocs, best.errors, (long)ru.ru_maxrss);
+
+    if (output)
+    {
+        FILE *f = fopen (output, "a");
+        if (!f)
+        {
+            perror (output);
+            return -1;
+        }
+
+        fprintf (f, "%s\t%s\t%s\t%s\t%d\t%ld\t%.6f\t%.2f\t%.3f\t%ld\t%d\t%ld\n",
+                 label, bench, shapes [shape].name, mode->name, text.size, best.tokens,
+                 best.time, mbps, mtps, best.allocs, best.errors, (long)ru.ru_maxrss);
+        fclose (f);
+    }
+
+    str_done (&text);
+    return 0;
+}
+
+static int bench_usage (const char *bench)
+{
+    fprintf (stderr, "Usage: %s [-o results.tsv] [-l label] [size[K|M]...]\n", bench);
+    return -1;
+}
+
+int bench_main (int argc, const char **argv, const char *bench,
+                const bench_mode_t *modes, int count)
+{
+    const char *output = NULL, *label = "-";
+    int sizes [BENCH_MAX_SIZES], nsizes = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp (argv [i], "-o") == 0) && (i + 1 < argc))
+            output = argv [++i];
+        else if ((strcmp (argv [i], "-l") == 0) && (i + 1 < argc))
+            label = argv [++i];
+        else
+        {
+            char *end;
+            long size = strtol (argv [i], &end, 10);
+            if ((*end == 'K') || (*end == 'k'))
+                size *= 1024, end++;
+            else if ((*end == 'M') || (*end == 'm'))
+                size *= 1024 * 1024, end++;
+
+            if (*end || (size <= 0) || (size > INT_MAX / 4) || (nsizes >= BENCH_MAX_SIZES))
+                return bench_usage (bench);
+            sizes [nsizes++] = (int)size;
+        }
+    }
+
+    if (nsizes == 0)
+        for (unsigned i = 0; i < ARRAY_LEN (default_sizes); i++)
+            sizes [nsizes++] = default_sizes [i];
+
+    // Write the header to a new results file
+    if (output)
+    {
+        FILE *f = fopen (output, "a");
+        if (!f)
+        {
+            perror (output);
+            return -1;
+        }
+        if (ftell (f) == 0)
+            fprintf (f, "label\tbench\tshape\tmode\tbytes\ttokens\tseconds"
+                     "\tmb_per_s\tmtokens_per_s\tallocs\terrors\tmaxrss_kb\n");
+        fclose (f);
+    }
+
+    printf ("%-8s %9s %-7s %8s %9s %10s %8s %7s %9s\n", "shape", "bytes", "mode",
+            "MB/s", "Mtoken/s", "tokens", "allocs", "errors", "RSS KB");
+
+    for (int i = 0; i < nsizes; i++)
+        for (int shape = 0; shape < BENCH_SHAPES; shape++)
+            for (int m = 0; m < count; m++)
+            {
+                // Don't let the child print our buffered output again
+                fflush (stdout);
+
+                pid_t pid = fork ();
+                if (pid < 0)
+                {
+                    perror ("fork");
+                    return -1;
+                }
+
+                if (pid == 0)
+                    exit (bench_child (bench, output, label,
+                                       (bench_shape_t)shape, sizes [i], &modes [m]));
+
+                int status;
+                if ((waitpid (pid, &status, 0) != pid) ||
+                    !WIFEXITED (status) || (WEXITSTATUS (status) != 0))
+                {
+                    fprintf (stderr, "%s: %s %s failed\n", bench, shapes [shape].name, modes [m].name);
+                    return -1;
+                }
+            }
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+/* The Cook project
+ * Common code for tokenizer and parser benchmarks
+ *
+ * Copyright (c) 2018 Andrey Zabolotnyi <zapparello@ya.ru>
+ * See file docs/COPYING for copying conditions
+ */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "str.h"
+
+#include <time.h>
+
+/// Synthetic recipe shapes
+typedef enum
+{
+    /// Plain assignments and comments, mostly short words
+    BENCH_FLAT,
+    /// Functions, nested blocks and unveils
+    BENCH_NESTED,
+    /// Quoted multi-line strings and escapes
+    BENCH_STRINGS,
+    /// All of the above, randomly mixed
+    BENCH_MIXED,
+
+    BENCH_SHAPES
+} bench_shape_t;
+
+/// The result of one benchmark run
+typedef struct
+{
+    /// Number of tokens processed
+    long tokens;
+    /// Time spent, in seconds
+    double time;
+    /// Number of heap allocations (see bench_alloc_count())
+    long allocs;
+    /// Number of syntax errors found
+    int errors;
+} bench_run_t;
+
+/// A benchmarked operation
+typedef struct
+{
+    /// Short mode name, used in reports
+    const char *name;
+    /// Process the text and fill the run result
+    void (*run) (str_t *text, bench_run_t *run);
+    /// true if the recipes must be accepted by the parser
+    bool parse;
+} bench_mode_t;
+
+/**
+ * Generate a synthetic recipe from the constructs found
+ * in tests/tokenizer/ *.rcp. Not all of them are accepted by the
+ * parser yet, so a recipe for parsing uses just the ones it accepts.
+ *
+ * @param text The string to initialize with the recipe.
+ * @param shape The kind of recipe.
+ * @param size Approximate text size in bytes.
+ * @param parse true to use only the constructs the parser accepts.
+ */
+extern void bench_recipe (str_t *text, bench_shape_t shape, int size, bool parse);
+
+/**
+ * Get monotonic time in seconds. This is inline, so that other tests
+ * may use it without linking bench.c (which wraps malloc() and friends).
+ *
+ * @return Current time.
+ */
+static inline double bench_now (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Get the number of heap allocations made so far. The benchmarks
+ * are linked with malloc(), calloc() and realloc() wrapped (see
+ * bench.mak), so every call from the libraries is counted, not just
+ * string buffers. The function is thread-safe.
+ *
+ * @return The number of calls to malloc(), calloc() and realloc().
+ */
+extern long bench_alloc_count (void);
+
+/**
+ * Run every mode over every recipe shape and size, and print
+ * the results. Every mode runs in a separate process, so the peak
+ * memory use is reported for that mode alone. Before every run
+ * the symbol table and the root context are freed, so every run
+ * pays for interning the same as the first one.
+ *
+ * Command line: [-o results.tsv] [-l label] [size[K|M]...]
+ * With -o, the results are also appended to the given file as
+ * tab-separated values (the header is written if the file is new),
+ * with the label (e.g. commit id) in first column, so results from
+ * different builds may be compared.
+ *
+ * @param argc The number of command line arguments.
+ * @param argv The command line arguments.
+ * @param bench Benchmark name.
+ * @param modes The modes to run.
+ * @param count The number of modes.
+ * @return The exit code for main().
+ */
+extern int bench_main (int argc, const char **argv, const char *bench,
+                       const bench_mode_t *modes, int count);
+
+#endif /* __BENCH_H__ */
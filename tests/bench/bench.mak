@@ -0,0 +1,15 @@
+# Count all heap allocations (see bench_alloc_count())
+BENCH_WRAP = -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+
+TESTS += tbench-lex tbench-parse
+DESCRIPTION.tbench-lex = Измерение скорости токенизатора на синтетических рецептах
+TARGETS.tbench-lex = tbench-lex$E
+SRC.tbench-lex$E = tests/bench/lex.c tests/bench/bench.c
+LIBS.tbench-lex += cooker$L useful$L
+LDFLAGS.tbench-lex += -pthread $(BENCH_WRAP)
+
+DESCRIPTION.tbench-parse = Измерение скорости синтаксического анализатора на синтетических рецептах
+TARGETS.tbench-parse = tbench-parse$E
+SRC.tbench-parse$E = tests/bench/parse.c tests/bench/bench.c
+LIBS.tbench-parse += cooker$L useful$L
+LDFLAGS.tbench-parse += -pthread $(BENCH_WRAP)
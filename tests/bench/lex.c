@@ -0,0 +1,120 @@
+#include "bench.h"
+#include "tokenizer.h"
+#include "token-buf.h"
+
+#include <stdio.h>
+#include <assert.h>
+#include <unistd.h>
+
+static str_t name = STR_INIT_C ("bench");
+
+// Tokenize the text in memory one token at a time
+static void lex_memory (str_t *text, bench_run_t *run)
+{
+    input_t in;
+    input_init (&in);
+    input_set_text (&in, text, &name);
+
+    run->allocs = bench_alloc_count ();
+    double time = bench_now ();
+
+    token_t tok;
+    while (input_token (&in, &tok))
+    {
+        run->tokens++;
+        if (tok.code == TOK_ERROR)
+            run->errors++;
+        token_done (&tok);
+    }
+
+    run->time = bench_now () - time;
+    run->allocs = bench_alloc_count () - run->allocs;
+    input_done (&in);
+}
+
+// Tokenize the text read from a file in chunks
+static void lex_file (str_t *text, bench_run_t *run)
+{
+    FILE *f = tmpfile ();
+    assert (f);
+    assert (fwrite (text->data, 1, (size_t)text->size, f) == (size_t)text->size);
+    assert (fflush (f) == 0);
+    assert (lseek (fileno (f), 0, SEEK_SET) == 0);
+
+    input_t in;
+    input_init (&in);
+
+    run->allocs = bench_alloc_count ();
+    double time = bench_now ();
+
+    assert (input_set_fd (&in, fileno (f), &name, 0));
+    token_t tok;
+    while (input_token (&in, &tok))
+    {
+        run->tokens++;
+        if (tok.code == TOK_ERROR)
+            run->errors++;
+        token_done (&tok);
+    }
+
+    run->time = bench_now () - time;
+    run->allocs = bench_alloc_count () - run->allocs;
+    assert (!in.read_error);
+    input_done (&in);
+    fclose (f);
+}
+
+// Tokenize the text into a token buffer
+static void lex_buffer (str_t *text, bench_run_t *run)
+{
+    input_t in;
+    input_init (&in);
+    input_set_text (&in, text, &name);
+
+    token_buf_t buf;
+    token_buf_init (&buf);
+
+    run->allocs = bench_alloc_count ();
+    double time = bench_now ();
+    assert (token_buf_fill (&buf, &in));
+    run->time = bench_now () - time;
+    run->allocs = bench_alloc_count () - run->allocs;
+    run->tokens = buf.size;
+
+    token_buf_done (&buf);
+    input_done (&in);
+}
+
+// Tokenize the text into a token buffer using all processors
+static void lex_threads (str_t *text, bench_run_t *run)
+{
+    input_t in;
+    input_init (&in);
+    input_set_text (&in, text, &name);
+
+    token_buf_t buf;
+    token_buf_init (&buf);
+
+    run->allocs = bench_alloc_count ();
+    double time = bench_now ();
+    assert (token_buf_fill_parallel (&buf, &in, 0, 0));
+    run->time = bench_now () - time;
+    run->allocs = bench_alloc_count () - run->allocs;
+    run->tokens = buf.size;
+
+    token_buf_done (&buf);
+    input_done (&in);
+}
+
+static const bench_mode_t modes [] =
+{
+    { "memory", lex_memory, false },
+    { "file", lex_file, false },
+    { "buffer", lex_buffer, false },
+    { "thread", lex_threads, false },
+};
+
+int main (int argc, const char **argv)
+{
+    return bench_main (argc, argv, "lex", modes, ARRAY_LEN (modes));
+}
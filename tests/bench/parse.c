@@ -0,0 +1,55 @@
+#include "bench.h"
+#include "parser.h"
+
+#include <assert.h>
+
+static str_t name = STR_INIT_C ("bench");
+
+// Parse the tokens, which are extracted beforehand
+static void parse_tokens (str_t *text, bench_run_t *run)
+{
+    parser_t parser;
+    parser_init (&parser, NULL, NULL);
+    input_set_text (&parser.input, text, &name);
+    assert (parser_lex (&parser));
+
+    run->allocs = bench_alloc_count ();
+    double time = bench_now ();
+    assert (parser_parse (&parser));
+    run->time = bench_now () - time;
+    run->allocs = bench_alloc_count () - run->allocs;
+    run->tokens = parser.token_idx;
+    run->errors = parser.errors;
+
+    parser_done (&parser);
+}
+
+// Tokenize and parse the text
+static void parse_text (str_t *text, bench_run_t *run)
+{
+    parser_t parser;
+    parser_init (&parser, NULL, NULL);
+
+    run->allocs = bench_alloc_count ();
+    double time = bench_now ();
+    input_set_text (&parser.input, text, &name);
+    assert (parser_lex (&parser));
+    assert (parser_parse (&parser));
+    run->time = bench_now () - time;
+    run->allocs = bench_alloc_count () - run->allocs;
+    run->tokens = parser.token_idx;
+    run->errors = parser.errors;
+
+    parser_done (&parser);
+}
+
+static const bench_mode_t modes [] =
+{
+    { "parse", parse_tokens, true },
+    { "full", parse_text, true },
+};
+
+int main (int argc, const char **argv)
+{
+    return bench_main (argc, argv, "parse", modes, ARRAY_LEN (modes));
+}
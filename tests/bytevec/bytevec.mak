@@ -0,0 +1,5 @@
+TESTS += tbytevec
+DESCRIPTION.tbytevec = Проверка функций сериализации в байтовый вектор
+TARGETS.tbytevec = tbytevec$E
+SRC.tbytevec$E = tests/bytevec/main.c
+LIBS.tbytevec += useful$L
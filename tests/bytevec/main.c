@@ -0,0 +1,167 @@
+#include "bytevec.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static const uint64_t uvalues [] =
+{
+    0, 1, 0x7f, 0x80, 0x3fff, 0x4000, 300, 0xffffffff, 0x123456789abcULL, UINT64_MAX
+};
+
+static const int64_t svalues [] =
+{
+    0, -1, 1, -64, 64, -65, INT32_MIN, INT32_MAX, INT64_MIN, INT64_MAX
+};
+
+static void dump (int n, const byte_vector_t *bv)
+{
+    printf ("%d. [", n);
+    for (int i = 0; i < bv->size; i++)
+        printf ("%s%02x", i ? " " : "", (uint8_t)bv->data [i]);
+    printf ("]\n");
+}
+
+static void write_record (byte_vector_t *bv)
+{
+    str_t text = STR_INIT_C ("hello");
+    str_t empty = STR_INIT_EMPTY;
+
+    assert (byte_vector_put_u8 (bv, 0xca));
+    assert (byte_vector_put_u16 (bv, 0xfe01));
+    assert (byte_vector_put_u32 (bv, 0xdeadbeef));
+    assert (byte_vector_put_u64 (bv, 0x0102030405060708ULL));
+    for (unsigned i = 0; i < ARRAY_LEN (uvalues); i++)
+        assert (byte_vector_put_uvar (bv, uvalues [i]));
+    for (unsigned i = 0; i < ARRAY_LEN (svalues); i++)
+        assert (byte_vector_put_svar (bv, svalues [i]));
+    assert (byte_vector_put_str (bv, &text));
+    assert (byte_vector_put_str (bv, &empty));
+    assert (byte_vector_put_blob (bv, "\0\1\2", 3));
+}
+
+// Read a record back, returns false if the data doesn't match
+static bool read_record (byte_reader_t *rd)
+{
+    bool ok = (byte_reader_u8 (rd) == 0xca);
+    ok &= (byte_reader_u16 (rd) == 0xfe01);
+    ok &= (byte_reader_u32 (rd) == 0xdeadbeef);
+    ok &= (byte_reader_u64 (rd) == 0x0102030405060708ULL);
+    for (unsigned i = 0; i < ARRAY_LEN (uvalues); i++)
+        ok &= (byte_reader_uvar (rd) == uvalues [i]);
+    for (unsigned i = 0; i < ARRAY_LEN (svalues); i++)
+        ok &= (byte_reader_svar (rd) == svalues [i]);
+
+    str_t text;
+    ok &= byte_reader_str (rd, &text);
+    ok &= (text.size == 5 && memcmp (text.data, "hello", 5) == 0);
+    // strings refer to the source data
+    ok &= (text.allocated == 0);
+    ok &= byte_reader_str (rd, &text);
+    ok &= (text.size == 0);
+
+    int size;
+    const uint8_t *blob = byte_reader_blob (rd, &size);
+    ok &= (blob && (size == 3) && (memcmp (blob, "\0\1\2", 3) == 0));
+
+    return ok && byte_reader_ok (rd);
+}
+
+int main ()
+{
+    byte_vector_t bv;
+    byte_reader_t rd;
+
+    // The encoding is fixed, check it byte by byte
+    byte_vector_init (&bv);
+    assert (byte_vector_put_uvar (&bv, 300));
+    assert (byte_vector_put_svar (&bv, -3));
+    assert (byte_vector_put_u32 (&bv, 0x11223344));
+    assert (byte_vector_put_blob (&bv, "ab", 2));
+    dump (1, &bv);
+    byte_vector_done (&bv);
+
+    // Varint lengths
+    byte_vector_init (&bv);
+    for (unsigned i = 0; i < ARRAY_LEN (uvalues); i++)
+    {
+        int size = bv.size;
+        assert (byte_vector_put_uvar (&bv, uvalues [i]));
+        printf ("%s%d", i ? " " : "2. [", bv.size - size);
+    }
+    printf ("]\n");
+    byte_vector_done (&bv);
+
+    // Round trip
+    byte_vector_init (&bv);
+    for (int i = 0; i < 100; i++)
+        write_record (&bv);
+    printf ("3. [%d bytes]\n", bv.size);
+
+    long allocs = str_alloc_count ();
+    byte_reader_init_str (&rd, &bv);
+    for (int i = 0; i < 100; i++)
+        assert (read_record (&rd));
+    printf ("4. [read %d bytes, %d left]\n", byte_reader_pos (&rd), byte_reader_left (&rd));
+    // the reader doesn't allocate
+    assert (str_alloc_count () == allocs);
+
+    // Reading past the end fails and stays failed
+    assert (byte_reader_u32 (&rd) == 0);
+    assert (!byte_reader_ok (&rd));
+    assert (byte_reader_u8 (&rd) == 0);
+    assert (byte_reader_uvar (&rd) == 0);
+    printf ("5. [error %d]\n", rd.error);
+
+    // Truncated data
+    for (int size = 0; size < 20; size++)
+    {
+        byte_reader_init (&rd, bv.data, size);
+        assert (!read_record (&rd));
+        assert (!byte_reader_ok (&rd) && (byte_reader_left (&rd) == 0));
+    }
+    byte_vector_done (&bv);
+
+    // Malformed numbers
+    static const uint8_t bad_uvar [] = { 0x80, 0x80 };
+    byte_reader_init (&rd, bad_uvar, sizeof (bad_uvar));
+    assert (byte_reader_uvar (&rd) == 0 && !byte_reader_ok (&rd));
+    static const uint8_t long_uvar [] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x02 };
+    byte_reader_init (&rd, long_uvar, sizeof (long_uvar));
+    assert (byte_reader_uvar (&rd) == 0 && !byte_reader_ok (&rd));
+    static const uint8_t long_blob [] = { 0x05, 'a', 'b' };
+    byte_reader_init (&rd, long_blob, sizeof (long_blob));
+    int size;
+    assert (byte_reader_blob (&rd, &size) == NULL && size == 0 && !byte_reader_ok (&rd));
+
+    // A blob with negative size is not written, not even its length
+    byte_vector_init (&bv);
+    assert (byte_vector_put_u8 (&bv, 1));
+    assert (!byte_vector_put_blob (&bv, "x", -1));
+    assert ((bv.size == 1) && (bv.data [1] == '\0'));
+    byte_vector_done (&bv);
+    printf ("6. [malformed data rejected]\n");
+
+    // Read from a mapped temporary file
+    byte_vector_init (&bv);
+    write_record (&bv);
+    FILE *f = tmpfile ();
+    assert (f);
+    assert (fwrite (bv.data, 1, (size_t)bv.size, f) == (size_t)bv.size);
+    assert (fflush (f) == 0);
+
+    char fn [32];
+    snprintf (fn, sizeof (fn), "/dev/fd/%d", fileno (f));
+    str_t file;
+    assert (str_init_file (&file, fn));
+    assert (file.size == bv.size);
+    byte_reader_init_str (&rd, &file);
+    assert (read_record (&rd));
+    printf ("7. [read %d bytes from file]\n", byte_reader_pos (&rd));
+    str_done (&file);
+    byte_vector_done (&bv);
+    fclose (f);
+
+    return 0;
+}
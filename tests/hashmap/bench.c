@@ -0,0 +1,74 @@
+#include "strmap.h"
+#include "strvec.h"
+#include "../bench/bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define LOOKUPS (1024 * 1024)
+
+static str_t *make_key (int i)
+{
+    char temp [32];
+    int len = snprintf (temp, sizeof (temp), "target.%d.CFLAGS", i * 7919);
+    return str_new_c_copy (temp, len);
+}
+
+static void bench (int count)
+{
+    int i;
+    str_t **keys = malloc ((size_t)count * sizeof (str_t *));
+    assert (keys);
+    for (i = 0; i < count; i++)
+        keys [i] = make_key (i);
+
+    // Sorted vector
+    vector_t vec;
+    vector_str_init (&vec, 0);
+
+    double time = bench_now ();
+    for (i = 0; i < count; i++)
+        assert (vector_insert_sorted (&vec, make_key (i)) >= 0);
+    double vec_insert = bench_now () - time;
+
+    time = bench_now ();
+    for (i = 0; i < LOOKUPS; i++)
+        assert (vector_find_sorted_key (&vec, keys [i % count]) >= 0);
+    double vec_lookup = bench_now () - time;
+
+    vector_done (&vec);
+
+    // Hash map
+    hashmap_t map;
+    hashmap_str_init (&map, 0);
+
+    time = bench_now ();
+    for (i = 0; i < count; i++)
+        assert (hashmap_set (&map, make_key (i)));
+    double map_insert = bench_now () - time;
+
+    time = bench_now ();
+    for (i = 0; i < LOOKUPS; i++)
+        assert (hashmap_get (&map, keys [i % count]));
+    double map_lookup = bench_now () - time;
+
+    hashmap_done (&map);
+
+    printf ("%8d items: insert %8.1f / %6.1f ns, lookup %6.1f / %6.1f ns (vector / hashmap)\n",
+            count, vec_insert * 1e9 / count, map_insert * 1e9 / count,
+            vec_lookup * 1e9 / LOOKUPS, map_lookup * 1e9 / LOOKUPS);
+
+    for (i = 0; i < count; i++)
+        str_free (keys [i]);
+    free (keys);
+}
+
+int main ()
+{
+    for (int count = 16; count <= 64 * 1024; count *= 4)
+        bench (count);
+
+    str_finalize ();
+    return 0;
+}
@@ -0,0 +1,10 @@
+TESTS += thashmap tbench-hashmap
+DESCRIPTION.thashmap = Проверка функций работы с хэш-таблицами
+TARGETS.thashmap = thashmap$E
+SRC.thashmap$E = tests/hashmap/main.c
+LIBS.thashmap += useful$L
+
+DESCRIPTION.tbench-hashmap = Сравнение скорости хэш-таблицы и сортированного вектора
+TARGETS.tbench-hashmap = tbench-hashmap$E
+SRC.tbench-hashmap$E = tests/hashmap/bench.c
+LIBS.tbench-hashmap += useful$L
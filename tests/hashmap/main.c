@@ -0,0 +1,113 @@
+#include "strmap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define COUNT   10000
+
+static str_t *make_key (int i)
+{
+    char temp [32];
+    int len = snprintf (temp, sizeof (temp), "VAR%d", i);
+    return str_new_c_copy (temp, len);
+}
+
+static void test_map (int n, hashmap_t *map)
+{
+    // Test the integrity of the hash map
+    int count = 0;
+    for (unsigned i = 0; map->slots && (i <= map->mask); i++)
+    {
+        hashmap_slot_t *slot = &map->slots [i];
+        if (!slot->item)
+            continue;
+
+        // Every element must be reachable from its home slot
+        count++;
+        assert (slot->hash == map->vmt->hash (slot->item));
+        for (unsigned j = (unsigned)slot->hash & map->mask; j != i; j = (j + 1) & map->mask)
+            assert (map->slots [j].item);
+    }
+    assert (count == hashmap_size (map));
+
+    printf ("%d. [%d items in %u slots]\n", n, count,
+            map->slots ? map->mask + 1 : 0);
+}
+
+int main ()
+{
+    int i;
+    hashmap_t map;
+
+    hashmap_str_init (&map, 0);
+    test_map (1, &map);
+
+    str_t key = STR_INIT_C ("VAR1");
+    assert (hashmap_get (&map, &key) == NULL);
+    assert (hashmap_take (&map, &key) == NULL);
+
+    for (i = 0; i < COUNT; i++)
+        assert (hashmap_set (&map, make_key (i)));
+    test_map (2, &map);
+
+    // Every key can be found, including constant keys
+    for (i = 0; i < COUNT; i++)
+    {
+        str_t *k = make_key (i);
+        str_t *found = hashmap_get (&map, k);
+        assert (found && (found != k) && str_equal (found, k));
+        str_free (k);
+    }
+    assert (str_equal (hashmap_get (&map, &key), &key));
+
+    // Replacing a element frees the old one
+    str_t *dup = make_key (1);
+    assert (hashmap_set (&map, dup));
+    assert (hashmap_size (&map) == COUNT);
+    assert (hashmap_get (&map, &key) == dup);
+
+    // Delete every odd key
+    for (i = 1; i < COUNT; i += 2)
+    {
+        str_t *k = make_key (i);
+        assert (hashmap_delete (&map, k));
+        assert (!hashmap_delete (&map, k));
+        str_free (k);
+    }
+    test_map (3, &map);
+
+    for (i = 0; i < COUNT; i++)
+    {
+        str_t *k = make_key (i);
+        assert ((hashmap_get (&map, k) != NULL) == !(i & 1));
+        str_free (k);
+    }
+
+    // Iterate over what's left
+    int pos = 0, count = 0;
+    str_t *item;
+    while ((item = hashmap_next (&map, &pos)))
+    {
+        assert (memcmp (item->data, "VAR", 3) == 0);
+        assert ((atoi (item->data + 3) & 1) == 0);
+        count++;
+    }
+    assert (count == COUNT / 2);
+
+    // Take an item out, it is not freed
+    str_t zero = STR_INIT_C ("VAR0");
+    item = hashmap_take (&map, &zero);
+    assert (item && str_equal (item, &zero));
+    str_free (item);
+
+    hashmap_clear (&map);
+    test_map (4, &map);
+
+    hashmap_done (&map);
+    str_finalize ();
+
+    printf ("...\nN. profit!\n");
+    return 0;
+}
@@ -1,65 +1,329 @@
-#include "tokenizer.h"
+#include "parser.h"
+#include "rand.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <assert.h>
 
 #define TEST_RCP "tests/tokenizer/test.rcp"
 
-bool load (const char *fn, str_t *str)
+static int errors;
+static int error_line, error_column;
+
+static void error (parser_t *parser, parser_pos_t *pos, const char *msg)
 {
-    FILE *inf = fopen (fn, "r");
-    if (!inf)
-        return false;
+    input_pos (&parser->input, pos->first_ofs, &error_line, &error_column);
+    printf ("%s:%d:%d: %s\n", str_c (&parser->input.name),
+            error_line + 1, error_column + 1, msg);
+    errors++;
+}
+
+// The buffer must contain exactly what the tokenizer returns one by one
+static void test_buffer (int n, const char *fn)
+{
+    input_t in;
+    input_init (&in);
+    assert (input_set_file (&in, fn));
+
+    token_buf_t buf;
+    token_buf_init (&buf);
+    assert (token_buf_fill (&buf, &in));
 
-    fseek (inf, 0, SEEK_END);
-    long fsize = ftell (inf);
-    fseek (inf, 0, SEEK_SET);
+    // Tokenize again, now without the buffer
+    str_t text;
+    str_init_copy (&text, &in.text);
+    input_set_text (&in, &text, &in.name);
 
-    if (fsize < 0)
+    int idx = 0;
+    token_t tok, btok;
+    while (input_token (&in, &tok))
     {
-        fclose (inf);
-        return false;
+        token_buf_get (&buf, &in, idx++, &btok);
+        assert ((btok.code == tok.code) ||
+                // all line breaks are NEXT in the buffer
+                ((btok.code == TOK_NEXT) && (tok.code == TOK_SPACE)));
+        assert (btok.ofs == tok.ofs);
+        assert (btok.text.data == tok.text.data);
+        assert (btok.text.size == tok.text.size);
+        assert (btok.escaped == tok.escaped);
+        assert (token_buf_sym (&buf, &in, idx - 1) == token_sym (&tok));
+        token_done (&tok);
     }
+    assert (idx == buf.size);
+
+    printf ("%d. %d tokens in buffer\n", n, buf.size);
+
+    str_done (&text);
+    token_buf_done (&buf);
+    input_done (&in);
+}
+
+static bool token_buf_equal (const token_buf_t *a, const token_buf_t *b)
+{
+    size_t n = (size_t)a->size;
+    return (a->size == b->size) &&
+        !memcmp (a->sym, b->sym, n * sizeof (str_t *)) &&
+        !memcmp (a->ofs, b->ofs, n * sizeof (int)) &&
+        !memcmp (a->len, b->len, n * sizeof (int)) &&
+        !memcmp (a->code, b->code, n) &&
+        !memcmp (a->flags, b->flags, n);
+}
 
-    char *buf = malloc (fsize);
-    if (fread (buf, 1, fsize, inf) != fsize)
+// Random edits must give same tokens as tokenizing the new text
+static void test_relex (int n, const char *fn, int edits)
+{
+    static const char *pieces [] =
     {
-        fclose (inf);
-        return false;
+        " ", "\n", "\n    ", "word", "\"", "\\n", "=", "+=", "${", "}", "#", ","
+    };
+
+    input_t in, full;
+    input_init (&in);
+    input_init (&full);
+    assert (input_set_file (&in, fn));
+
+    token_buf_t buf, fbuf;
+    token_buf_init (&buf);
+    token_buf_init (&fbuf);
+    assert (token_buf_fill (&buf, &in));
+
+    rand_state_t rs;
+    rand_init (&rs, n);
+
+    long relexed = 0, total = 0;
+    for (int i = 0; i < edits; i++)
+    {
+        int size = in.text.size;
+        int ofs = (int)rand_range (&rs, (uint32_t)size + 1);
+        int old_size = (int)rand_range (&rs, (uint32_t)imin (8, size - ofs) + 1);
+
+        str_t repl;
+        str_init (&repl);
+        for (int j = rand_range (&rs, 3); j > 0; j--)
+            assert (str_append_c_const (&repl, pieces [rand_range (&rs, ARRAY_LEN (pieces))], -1));
+
+        // The old text is freed as soon as the input gets the new one,
+        // so the new text must be a copy
+        int tail = size - ofs - old_size;
+        str_t text;
+        assert (str_init_alloc (&text, ofs + repl.size + tail));
+        if (ofs)
+            memcpy (text.data, in.text.data, (size_t)ofs);
+        if (repl.size)
+            memcpy (text.data + ofs, repl.data, (size_t)repl.size);
+        if (tail)
+            memcpy (text.data + ofs + repl.size, in.text.data + ofs + old_size, (size_t)tail);
+
+        input_set_text (&in, &text, &in.name);
+        int count;
+        assert (token_buf_relex (&buf, &in, ofs, old_size, repl.size, &count));
+
+        input_set_text (&full, &text, &in.name);
+        token_buf_clear (&fbuf);
+        assert (token_buf_fill (&fbuf, &full));
+        assert (token_buf_equal (&buf, &fbuf));
+
+        relexed += count;
+        total += fbuf.size;
+
+        str_done (&repl);
+        str_done (&text);
     }
 
-    str_init_c_prealloc (str, buf, fsize);
-    fclose (inf);
-    return true;
+    printf ("%d. %d edits, %ld of %ld tokens tokenized again\n",
+            n, edits, relexed, total);
+
+    token_buf_done (&buf);
+    token_buf_done (&fbuf);
+    input_done (&in);
+    input_done (&full);
 }
 
-int main (int argc, const char **argv)
+// A small edit in a large text must stay local
+static void test_relex_local (int n, const char *fn)
 {
-    const char *fn;
+    str_t part, text;
+    assert (str_init_file (&part, fn));
+    str_init (&text);
+    for (int i = 0; i < 1000; i++)
+        assert (str_append (&text, &part) && str_append_c_const (&text, "\n", 1));
+
+    parser_t parser;
+    parser_init (&parser, NULL, NULL);
+    input_set_text (&parser.input, &text, &part);
+    assert (parser_lex (&parser));
+    int size = parser.tokens.size;
+
+    // Insert a character in the middle
+    int ofs = text.size / 2;
+    str_t edited;
+    assert (str_init_alloc (&edited, text.size + 1));
+    memcpy (edited.data, text.data, (size_t)ofs);
+    edited.data [ofs] = 'x';
+    memcpy (edited.data + ofs + 1, text.data + ofs, (size_t)(text.size - ofs));
+
+    int count;
+    input_set_text (&parser.input, &edited, &part);
+    assert (token_buf_relex (&parser.tokens, &parser.input, ofs, 0, 1, &count));
+    printf ("%d. %d tokens, %d tokenized again after edit\n", n, size, count);
+    assert ((count > 0) && (count < 10));
+
+    // Undo the edit, this must give the original tokens
     input_t in;
+    input_init (&in);
+    input_set_text (&in, &text, &part);
+    token_buf_t orig;
+    token_buf_init (&orig);
+    assert (token_buf_fill (&orig, &in));
+
+    assert (parser_relex (&parser, &text, ofs, 1, 0));
+    assert (token_buf_equal (&parser.tokens, &orig));
 
+    token_buf_done (&orig);
+    input_done (&in);
+    parser_done (&parser);
+    str_done (&edited);
+    str_done (&text);
+    str_done (&part);
+}
+
+// Tokenizing in threads must give same tokens as in a single thread
+static bool test_parallel_text (str_t *text, int threads, int chunk)
+{
+    str_t name = STR_INIT_C ("test");
+    input_t in;
     input_init (&in);
 
-    if (argc < 2)
-        fn = TEST_RCP;
-    else
-        fn = argv [1];
+    token_buf_t buf, pbuf;
+    token_buf_init (&buf);
+    token_buf_init (&pbuf);
+
+    input_set_text (&in, text, &name);
+    assert (token_buf_fill (&buf, &in));
+    input_set_text (&in, text, &name);
+    assert (token_buf_fill_parallel (&pbuf, &in, threads, chunk));
+    assert (in.ofs == text->size);
+
+    bool ok = token_buf_equal (&buf, &pbuf);
+
+    token_buf_done (&buf);
+    token_buf_done (&pbuf);
+    input_done (&in);
+    return ok;
+}
+
+static void test_parallel (int n, const char *fn, int count)
+{
+    str_t part, text;
+    assert (str_init_file (&part, fn));
+    str_init (&text);
+    for (int i = 0; i < 1000; i++)
+        assert (str_append (&text, &part) && str_append_c_const (&text, "\n", 1));
 
-    if (!load (fn, &in.text))
+    for (int threads = 1; threads <= 8; threads++)
+        assert (test_parallel_text (&text, threads, 1));
+    printf ("%d. %d bytes, same tokens with 1 to 8 threads\n", n, text.size);
+
+    str_done (&text);
+    str_done (&part);
+
+    // Multi-line strings and comments make wrong split points
+    static const char *pieces [] =
+    {
+        " ", "\n", "\n    ", "word", "\"", "\\\"", "\\n", "=", "#", "\n\"\n", "\nA = \""
+    };
+
+    rand_state_t rs;
+    rand_init (&rs, n + 1);
+
+    for (int i = 0; i < count; i++)
     {
-        fprintf (stderr, "Failed to load input file '%s'\n", fn);
-        return -1;
+        str_init (&text);
+        for (int j = rand_range (&rs, 100); j >= 0; j--)
+            assert (str_append_c_const (&text, pieces [rand_range (&rs, ARRAY_LEN (pieces))], -1));
+
+        assert (test_parallel_text (&text, 2 + (int)rand_range (&rs, 7), 1));
+        str_done (&text);
     }
 
-    token_t tok;
-    while (input_token (&in, &tok))
+    printf ("%d. %d random texts, same tokens\n", n + 1, count);
+}
+
+static void test_parse (int n, const char *text, int expect_errors)
+{
+    parser_t parser;
+    parser_init (&parser, NULL, error);
+
+    str_t str, name = STR_INIT_C ("test");
+    str_init_c_const (&str, text, -1);
+    input_set_text (&parser.input, &str, &name);
+
+    errors = 0;
+    assert (parser_lex (&parser));
+    bool ok = parser_parse (&parser);
+    printf ("%d. %d tokens, %s, %d errors\n", n, parser.tokens.size,
+            ok ? "ok" : "failed", errors);
+    assert (errors == expect_errors);
+    assert (ok == (errors == 0));
+
+    parser_done (&parser);
+}
+
+// The words used as names must be interned by the parser, and only them
+static void test_names (int n, const char *text, const char *names)
+{
+    parser_t parser;
+    parser_init (&parser, NULL, error);
+
+    str_t str, name = STR_INIT_C ("test");
+    str_init_c_const (&str, text, -1);
+    input_set_text (&parser.input, &str, &name);
+
+    assert (parser_lex (&parser));
+    assert (parser_parse (&parser));
+
+    char interned [256] = "";
+    for (int idx = 0; idx < parser.tokens.size; idx++)
     {
+        const str_t *sym = parser.tokens.sym [idx];
+        if (!sym)
+            continue;
 
-        str_done (&tok.text);
+        token_t tok;
+        token_buf_get (&parser.tokens, &parser.input, idx, &tok);
+        assert (sym == str_intern (&tok.text));
+        token_done (&tok);
+
+        if (interned [0])
+            strcat (interned, " ");
+        strncat (interned, sym->data, (size_t)sym->size);
     }
 
-    input_done (&in);
+    printf ("%d. names: %s\n", n, interned);
+    assert (strcmp (interned, names) == 0);
+
+    parser_done (&parser);
+}
+
+int main (int argc, const char **argv)
+{
+    const char *fn = (argc < 2) ? TEST_RCP : argv [1];
+
+    test_buffer (1, fn);
+
+    test_parse (2, "A = b c\nB += d\n", 0);
+    test_parse (3, "A = b\n}\nC = d\n", 1);
+    // the error location is exact
+    assert ((error_line == 1) && (error_column == 0));
+    test_parse (4, "A = \"b\n", 1);
+    test_relex (5, fn, 1000);
+    test_relex_local (6, fn);
+    test_parallel (7, fn, 2000);
+    test_names (9, "A = b\nX = {Y = c\n}\ninfo $Z w\nV ?= ${F g}\n",
+                "A X Y info Z V F");
 
+    var_done_root_ctx ();
     str_finalize ();
     printf ("\nDone!\n");
 
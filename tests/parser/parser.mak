@@ -3,3 +3,4 @@ DESCRIPTION.tparser = Проверка синтаксического анали
 TARGETS.tparser = tparser$E
 SRC.tparser$E = $(wildcard tests/parser/*.c)
 LIBS.tparser += cooker$L useful$L
+LDFLAGS.tparser += -pthread
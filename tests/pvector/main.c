@@ -0,0 +1,145 @@
+#include "pvector.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define COUNT   1000
+
+// A reference-counted test element
+typedef struct
+{
+    int refs;
+    int value;
+} item_t;
+
+// Number of elements alive
+static int items_alive = 0;
+
+static item_t *item_new (int value)
+{
+    item_t *item = malloc (sizeof (item_t));
+    item->refs = 1;
+    item->value = value;
+    items_alive++;
+    return item;
+}
+
+static void item_retain (void *item)
+{
+    ((item_t *)item)->refs++;
+}
+
+static void item_release (void *item)
+{
+    item_t *it = item;
+    assert (it->refs > 0);
+    if (--it->refs == 0)
+    {
+        free (it);
+        items_alive--;
+    }
+}
+
+static const pvector_vmt_t item_vmt =
+{
+    item_retain,
+    item_release,
+};
+
+// Check that vec contains size elements with values first, first + 1, ...
+static void test_values (int n, const pvector_t *vec, int first, int size)
+{
+    assert (pvector_size (vec) == size);
+
+    int count = 0;
+    for (int pos = 0; pos < vec->size; )
+    {
+        void **items;
+        int chunk = pvector_chunk (vec, pos, &items);
+        assert (chunk > 0);
+        for (int i = 0; i < chunk; i++)
+        {
+            item_t *item = items [i];
+            assert (item == pvector_get (vec, pos + i));
+            assert (item->value == first + pos + i);
+        }
+        pos += chunk;
+        count += chunk;
+    }
+    assert (count == size);
+    assert (pvector_get (vec, size) == NULL);
+
+    printf ("%d. [%d items, first %d, %d alive]\n", n, size, first, items_alive);
+}
+
+int main ()
+{
+    pvector_t v1, v2, v3;
+
+    pvector_init (&v1, &item_vmt);
+    test_values (1, &v1, 0, 0);
+
+    // Grow a tree several levels high
+    for (int i = 0; i < COUNT; i++)
+        assert (pvector_append (&v1, item_new (i)));
+    test_values (2, &v1, 0, COUNT);
+
+    // A copy shares everything
+    pvector_init_copy (&v2, &v1);
+    assert (items_alive == COUNT);
+    test_values (3, &v2, 0, COUNT);
+
+    // Modifying the copy leaves the original intact
+    item_t *old = pvector_get (&v2, 500);
+    assert (pvector_replace (&v2, 500, item_new (-1)));
+    assert (((item_t *)pvector_get (&v2, 500))->value == -1);
+    assert (pvector_get (&v1, 500) == old && old->refs == 1);
+    assert (pvector_append (&v2, item_new (COUNT)));
+    test_values (4, &v1, 0, COUNT);
+
+    pvector_done (&v2);
+    assert (items_alive == COUNT);
+
+    // A slice, then appending to it must not touch the original
+    pvector_init_slice (&v3, &v1, 100, 50);
+    test_values (5, &v3, 100, 50);
+    for (int i = 150; i < 200; i++)
+        assert (pvector_append (&v3, item_new (i)));
+    test_values (6, &v3, 100, 100);
+    assert (((item_t *)pvector_get (&v1, 150))->refs == 1);
+
+    // Dropping the original frees elements not in the slice
+    pvector_done (&v1);
+    test_values (7, &v3, 100, 100);
+
+    // Appending to a trimmed slice we own replaces stale elements
+    pvector_init_slice (&v1, &v3, 0, 10);
+    pvector_done (&v3);
+    assert (pvector_append (&v1, item_new (110)));
+    test_values (8, &v1, 100, 11);
+
+    // Joining a vector with itself
+    pvector_init (&v2, &item_vmt);
+    for (int i = 0; i < 40; i++)
+        assert (pvector_append (&v2, item_new (i)));
+    assert (pvector_join (&v2, &v2));
+    assert (pvector_size (&v2) == 80);
+    for (int i = 0; i < 80; i++)
+        assert (((item_t *)pvector_get (&v2, i))->value == i % 40);
+    assert (((item_t *)pvector_get (&v2, 0))->refs == 2);
+
+    // Assignment shares the value, the old one is released
+    pvector_set (&v1, &v2);
+    pvector_done (&v2);
+    assert (pvector_size (&v1) == 80);
+    pvector_init_slice (&v2, &v1, 40, -1);
+    pvector_done (&v1);
+    test_values (9, &v2, 0, 40);
+    pvector_done (&v2);
+
+    assert (items_alive == 0);
+    printf ("10. [%d alive]\n", items_alive);
+
+    return 0;
+}
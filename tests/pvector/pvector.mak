@@ -0,0 +1,5 @@
+TESTS += tpvector
+DESCRIPTION.tpvector = Проверка функций работы с персистентными векторами
+TARGETS.tpvector = tpvector$E
+SRC.tpvector$E = tests/pvector/main.c
+LIBS.tpvector += useful$L
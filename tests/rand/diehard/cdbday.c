@@ -1,7 +1,7 @@
 #include "header.h"
 
-static real chi_fit;
-static int    dgf;
+static _Thread_local real chi_fit;
+static _Thread_local int    dgf;
 
 int ucmpr(const void *u1, const void *u2);
 
@@ -24,7 +24,7 @@ real P_fit(real lambda, counter *obs, int no_obs)
       Ef[j]+=no_obs*Poisson(lambda, i);
     }
 
-    while( obs[k]<=i ){
+    while( k<no_obs && obs[k]<=i ){
       ++f[j];
       ++k;
     }
@@ -43,10 +43,9 @@ real P_fit(real lambda, counter *obs, int no_obs)
   }
 
   dgf=j;
-/*
-  cfree(f, dim, sizeof(counter));
-  cfree(Ef, dim, sizeof(real));
-*/
+
+  free(f);
+  free(Ef);
 
   return 1-Chisq(dgf,chi_fit);
 }
@@ -65,8 +65,8 @@ void monky_ttl(char *fn, char *test)
 /* get a word from specific bits */
 unsigned long get_w(char *fn, short bits_pl, int rt)
 {
-  static int flag=-1, ltrs_pw;
-  static unsigned long wd, maskltr;
+  static _Thread_local int flag=-1, ltrs_pw;
+  static _Thread_local unsigned long wd, maskltr;
   short i;
 
   wd <<= bits_pl;
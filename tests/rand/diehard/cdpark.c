@@ -83,7 +83,7 @@ void park(char *filename)
   }
   uni("close");
 
-  free(p); free(x); free(y);
+  free(x); free(y);
 
   mean=(real)sum/no_obs;
   var=(real)ss/no_obs-mean*mean;
@@ -92,6 +92,7 @@ void park(char *filename)
   printf(" sample std.=%.2f\n", sqrt(var)); 
  
   pvalue=KStest(p, no_obs);
+  free(p);
   printf("\t     p-value of the KSTEST for those %ld", no_obs);
   printf(" p-values: %f\n\n", pvalue);
     
@@ -27,8 +27,8 @@ letters b2l(int byte)
 /* get a byte from a stream of bytes */
 int getb(char *filename, int rt)
 {
-  static short rest=0;
-  static uniform wd;
+  static _Thread_local short rest=0;
+  static _Thread_local uniform wd;
 
   if(rest==0){
     wd=uni(filename);
@@ -38,47 +38,57 @@ int fcmpr(const void *f1, const void *f2)
   return 1;
 }
 
-/*read in a uniform random number from a file*/
-uniform uni(char *filename)
-{
-  static FILE *infile;
-
-  static char isopen='n';
-  static counter count=DIM;
-  static uniform uniran[DIM];
+/*the sample and the read position of this thread*/
+static _Thread_local const uniform *uniran;
+static _Thread_local counter unisize, count;
 
- /* uniform fortran[1]; */ 
+void uni_open(const uniform *data, counter size)
+{
+  uniran=data;
+  unisize=size;
+  count=0;
+}
 
+/*read in a uniform random number from the sample*/
+uniform uni(char *filename)
+{
   if( strcmp(filename, "close")==0 ){
-    fclose(infile);
-    isopen='n';
-    count=DIM;
+    count=0;
 
     return 0;
   }
-    
-  if( (++count)<DIM ){
-    return uniran[count];
-  }
 
-  if( isopen=='n' ){
-    if( (infile=fopen(filename, "r"))==NULL ){
-      printf("can't open file %s!!!\n", filename);
+  /*wrap around like a endless file would do*/
+  if( count>=unisize ){
+    if( !unisize ){
+      fprintf(stderr, "no sample for %s!!!\n", filename);
       exit(1);
     }
-
-    isopen='y';
-/*fread( fortran, sizeof(uniform), 1 , infile );*/ /*for binary file written*/
-                                                   /*by fortran program*/
+    count=0;
   }
 
-  fread( uniran, sizeof(uniform), DIM , infile );
+  return uniran[count++];
+}
 
-  count=0;
-/*fread( fortran, sizeof(uniform), 1 , infile );
-fread( fortran, sizeof(uniform), 1 , infile );*/
+static _Thread_local FILE *dh_out;
+
+void dh_set_output(FILE *out)
+{
+  dh_out=out;
+}
+
+FILE *dh_output(void)
+{
+  return dh_out ? dh_out : stdout;
+}
+
+int dh_puts(const char *s)
+{
+  FILE *out=dh_output();
+
+  if( fputs(s, out)<0 ) return EOF;
 
-  return uniran[count];
+  return fputc('\n', out);
 }
 
 /*show the bit-pattern of an integer*/
@@ -16,8 +16,32 @@ typedef unsigned long   counter;
 
 typedef double          real;
 
+/*
+ * The tests read random numbers from a in-memory sample and print their
+ * results to a per-thread stream, so several tests may run concurrently
+ * in different threads. Every thread must call uni_open() before running
+ * a test; the filename argument of the tests is only used in reports.
+ */
+
+/*set the sample for the tests run by this thread*/
+void uni_open(const uniform *data, counter size);
+
+/*get next number from the sample, uni("close") rewinds to sample start*/
 uniform uni(char *filename);
 
+/*set the stream for test output in this thread (NULL for stdout)*/
+void dh_set_output(FILE *out);
+
+/*get the stream for test output in this thread*/
+FILE *dh_output(void);
+
+int dh_puts(const char *s);
+
+#undef printf
+#define printf(...)     fprintf(dh_output(), __VA_ARGS__)
+#undef puts
+#define puts(s)         dh_puts(s)
+
 double Phi(double z);
 
 double Chisq(int df, double chsq);
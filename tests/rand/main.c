@@ -1,22 +1,203 @@
-#include "useful.h"
+#include "rand.h"
 #include "diehard/header.h"
+#include "../bench/bench.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #define SIZE (16 * 1024 * 1024)
 
+// Check the bulk generator gives the same numbers as rand_next()
+static void test_fill (rand_state_t *rs)
+{
+    rand_state_t copy = *rs;
+    uint64_t buff [33];
+    uint8_t *bytes = (uint8_t *)buff;
+
+    // Odd size to check the tail too
+    rand_fill (rs, buff, sizeof (buff) - 3);
+    uint64_t x = 0;
+    for (int i = 0; i < (int)(sizeof (buff) - 3); i++)
+    {
+        if (!(i & 7))
+            x = rand_next (&copy);
+        assert (bytes [i] == (uint8_t)(x >> ((i & 7) * 8)));
+    }
+    assert (memcmp (&copy, rs, sizeof (copy)) == 0);
+}
+
+// Check that jumped streams don't look like each other
+static void test_jump (rand_state_t *rs)
+{
+    rand_state_t streams [4];
+    streams [0] = *rs;
+    for (int i = 1; i < ARRAY_LEN (streams); i++)
+    {
+        streams [i] = streams [i - 1];
+        rand_jump (&streams [i]);
+    }
+
+    uint64_t first [ARRAY_LEN (streams)];
+    for (int i = 0; i < ARRAY_LEN (streams); i++)
+    {
+        first [i] = rand_next (&streams [i]);
+        for (int j = 0; j < i; j++)
+            assert (first [i] != first [j]);
+    }
+
+    for (int i = 0; i < 1000; i++)
+        assert (rand_range (rs, 10) < 10);
+}
+
+// ---------- // ---------- // ---------- // ---------- // ---------- //
+
+// The name of the sample in the reports
+static char *sample_name = "xoshiro256**";
+
+// A single Diehard test run
+typedef struct
+{
+    /// The name of the test
+    const char *name;
+    /// The test function
+    void (*run) (char *fn, char *test);
+    /// The argument of the test function
+    char *test;
+    /// The output of the test
+    char *output;
+    size_t output_size;
+    /// Test run time in seconds
+    double time;
+} diehard_job_t;
+
+#define DIEHARD_RUN(func) \
+static void run_##func (char *fn, char *test) \
+{ (void)test; func (fn); }
+
+DIEHARD_RUN (bday)
+DIEHARD_RUN (operm5)
+DIEHARD_RUN (bitst)
+DIEHARD_RUN (park)
+DIEHARD_RUN (mindist)
+DIEHARD_RUN (sphere)
+DIEHARD_RUN (squeez)
+DIEHARD_RUN (osum)
+DIEHARD_RUN (runtest)
+DIEHARD_RUN (craptest)
+
+// The longest tests go first, so that they don't run last alone
+static diehard_job_t diehard_jobs [] =
+{
+    { "monky DNA", monky, "DNA" },
+    { "park", run_park, NULL },
+    { "bday", run_bday, NULL },
+    { "monky OQSO", monky, "OQSO" },
+    { "binrnk 6x8", binrnk, "6x8" },
+    { "monky OPSO", monky, "OPSO" },
+    { "cnt1s specific", cnt1s, "specific" },
+    { "bitst", run_bitst, NULL },
+    { "cnt1s stream", cnt1s, "stream" },
+    { "binrnk 32x32", binrnk, "32x32" },
+    { "operm5", run_operm5, NULL },
+    { "mindist", run_mindist, NULL },
+    { "binrnk 31x31", binrnk, "31x31" },
+    { "sphere", run_sphere, NULL },
+    { "squeez", run_squeez, NULL },
+    { "craptest", run_craptest, NULL },
+    { "osum", run_osum, NULL },
+    { "runtest", run_runtest, NULL },
+};
+
+// The sample all tests are run on
+static const uniform *diehard_data;
+static counter diehard_size;
+// The index of next job to run
+static atomic_int diehard_next;
+
+static void *diehard_worker (void *arg)
+{
+    (void)arg;
+
+    for (;;)
+    {
+        int i = atomic_fetch_add (&diehard_next, 1);
+        if (i >= (int)ARRAY_LEN (diehard_jobs))
+            break;
+
+        diehard_job_t *job = &diehard_jobs [i];
+        FILE *out = open_memstream (&job->output, &job->output_size);
+        assert (out);
+
+        dh_set_output (out);
+        uni_open (diehard_data, diehard_size);
+
+        double start = bench_now ();
+        job->run (sample_name, job->test);
+        job->time = bench_now () - start;
+
+        dh_set_output (NULL);
+        fclose (out);
+    }
+
+    return NULL;
+}
+
+/* Run all Diehard tests on the sample, several at a time,
+ * then print their reports and the time each test took.
+ */
+static void run_diehard (const uint32_t *data, counter size)
+{
+    diehard_data = data;
+    diehard_size = size;
+    atomic_init (&diehard_next, 0);
+
+    // DIEHARD_THREADS may be set to compare timings
+    const char *env = getenv ("DIEHARD_THREADS");
+    long ncpu = env ? atol (env) : sysconf (_SC_NPROCESSORS_ONLN);
+    int nthreads = (int)imin (imax ((int)ncpu, 1), ARRAY_LEN (diehard_jobs));
+
+    double start = bench_now ();
+
+    pthread_t threads [ARRAY_LEN (diehard_jobs)];
+    for (int i = 0; i < nthreads; i++)
+        assert (pthread_create (&threads [i], NULL, diehard_worker, NULL) == 0);
+    for (int i = 0; i < nthreads; i++)
+        pthread_join (threads [i], NULL);
+
+    double wall = bench_now () - start;
+    double total = 0;
+
+    for (int i = 0; i < ARRAY_LEN (diehard_jobs); i++)
+    {
+        diehard_job_t *job = &diehard_jobs [i];
+        fwrite (job->output, 1, job->output_size, stdout);
+        free (job->output);
+        total += job->time;
+    }
+
+    printf ("\n\tDiehard test times (%d threads):\n", nthreads);
+    for (int i = 0; i < ARRAY_LEN (diehard_jobs); i++)
+        printf ("\t%-20s %8.3f s\n", diehard_jobs [i].name, diehard_jobs [i].time);
+    printf ("\t%-20s %8.3f s\n", "total", total);
+    printf ("\t%-20s %8.3f s\n", "wall", wall);
+}
+
 int main ()
 {
-    srand (0xd0decaed);
+    rand_state_t rs;
+    rand_init (&rs, 0xd0decaed);
+    test_fill (&rs);
+    test_jump (&rs);
 
     int i;
     uint32_t *data;
     data = malloc (SIZE * sizeof (uint32_t));
-    for (i = 0; i < SIZE; i++)
-        data [i] = rand ();
+    rand_fill (&rs, data, SIZE * sizeof (uint32_t));
 
     uint32_t freq [64];
     memset (freq, 0, sizeof (freq));
@@ -43,12 +224,6 @@ int main ()
     // Now push it through all circles of hell of the
     // Marsaglia's Diehard Battery of Tests of Randomness.
 
-    static char *fn = "rand.bin";
-    FILE *of = fopen (fn, "w");
-    assert (of);
-    assert (fwrite (data, sizeof (uint32_t), SIZE, of) == SIZE);
-    fclose (of);
-
     puts("\n\t\t\t\tNOTE\n");
 
     puts("\tMost of the tests in DIEHARD return a p-value, which");
@@ -66,22 +241,8 @@ int main ()
     puts("\tamong the hundreds that DIEHARD produces, even with good RNGs.");
     puts("\t So keep in mind that \"p happens\"\n");
 
+    run_diehard (data, SIZE);
 
-    bday(fn);
-    operm5(fn);
-    binrnk(fn,"31x31"); binrnk(fn,"32x32");
-    binrnk(fn,"6x8");
-    bitst(fn);
-    monky(fn, "OPSO"); monky(fn, "OQSO"); monky(fn, "DNA");
-    cnt1s(fn, "stream");
-    cnt1s(fn, "specific");
-    park(fn);
-    mindist(fn);
-    sphere(fn);
-    squeez(fn);
-    osum(fn);
-    runtest(fn);
-    craptest(fn);
-
+    free (data);
     return 0;
 }
@@ -4,3 +4,4 @@ TARGETS.trand = trand$E
 SRC.trand$E = $(wildcard tests/rand/*.c) \
     $(filter-out %/diehard.c,$(wildcard tests/rand/diehard/*.c))
 LIBS.trand += useful$L
+LDFLAGS.trand += -pthread
@@ -0,0 +1,80 @@
+#include "sstr.h"
+#include "../bench/bench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define WORDS   (1024 * 1024)
+#define LOOPS   8
+
+// A typical mix of words found in recipes
+static const char *vocabulary [] =
+{
+    "SRC", "CFLAGS", ".TARGETS", "info", "=", "+=", "${", "wildcard",
+    "A", "B", "QQP", "func", "tests/*/*.c", "VAR1", "value", "spanning",
+    "libs/cooker/tokenizer.c", "$(OUT)deps/.dir", "-O3 -fomit-frame-pointer",
+    "a rather long value which will never fit into a small string",
+};
+
+static void report (const char *what, double time, long allocs)
+{
+    double words = (double)WORDS * LOOPS;
+    printf ("%-8s %8.2f Mwords/s %8.1f ns/word %10ld allocs (%.3f per word)\n",
+            what, words / time / 1e6, time * 1e9 / words,
+            allocs, allocs / words);
+}
+
+int main ()
+{
+    int i, j;
+    size_t count = 0;
+
+    str_t *strs = malloc (WORDS * sizeof (str_t));
+    sstr_t *sstrs = malloc (WORDS * sizeof (sstr_t));
+    assert (strs && sstrs);
+
+    printf ("sizeof (str_t) = %d, sizeof (sstr_t) = %d, inline max = %d\n",
+            (int)sizeof (str_t), (int)sizeof (sstr_t), SSTR_INLINE_MAX);
+
+    // Plain str_t copies
+    long allocs = str_alloc_count ();
+    double time = bench_now ();
+    for (j = 0; j < LOOPS; j++)
+    {
+        for (i = 0; i < WORDS; i++)
+            assert (str_init_c_copy (&strs [i],
+                vocabulary [i % ARRAY_LEN (vocabulary)], -1));
+        for (i = 0; i < WORDS; i++)
+        {
+            count += strs [i].size;
+            str_done (&strs [i]);
+        }
+    }
+    report ("str_t", bench_now () - time, str_alloc_count () - allocs);
+
+    // Compact sstr_t copies
+    allocs = str_alloc_count ();
+    time = bench_now ();
+    for (j = 0; j < LOOPS; j++)
+    {
+        for (i = 0; i < WORDS; i++)
+            assert (sstr_init_c_copy (&sstrs [i],
+                vocabulary [i % ARRAY_LEN (vocabulary)], -1));
+        for (i = 0; i < WORDS; i++)
+        {
+            count -= sstr_size (&sstrs [i]);
+            sstr_done (&sstrs [i]);
+        }
+    }
+    report ("sstr_t", bench_now () - time, str_alloc_count () - allocs);
+
+    // Both loops must have seen the same text
+    assert (count == 0);
+
+    free (sstrs);
+    free (strs);
+
+    str_finalize ();
+    return 0;
+}
@@ -1,7 +1,17 @@
 #include "str.h"
+#include "sstr.h"
+#include "intern.h"
+#include "strbuild.h"
+#include "charset.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <pthread.h>
+
+#define SHARE_THREADS   4
+#define SHARE_LOOPS     100000
 
 static void test_str (int n, str_t *s)
 {
@@ -16,6 +26,301 @@ static void test_str (int n, str_t *s)
     fflush (stdout);
 }
 
+// Share and unshare a string from many threads at once
+static void *share_thread (void *arg)
+{
+    str_t *src = arg;
+    str_t copy;
+    str_init (&copy);
+
+    for (int i = 0; i < SHARE_LOOPS; i++)
+    {
+        str_set (&copy, src);
+        if (i & 1)
+            str_append_c_const (&copy, "!", 1);
+        str_done (&copy);
+    }
+
+    return NULL;
+}
+
+static void test_threads (int n)
+{
+    str_t *shared = str_new_c_copy ("A string shared between threads", -1);
+    pthread_t threads [SHARE_THREADS];
+
+    for (int i = 0; i < SHARE_THREADS; i++)
+        assert (pthread_create (&threads [i], NULL, share_thread, shared) == 0);
+    for (int i = 0; i < SHARE_THREADS; i++)
+        pthread_join (threads [i], NULL);
+
+    test_str (n, shared);
+    str_free (shared);
+}
+
+static void test_sstr (int n)
+{
+    sstr_t s;
+    str_t view;
+
+    assert (sstr_init_c_copy (&s, "short", -1));
+    assert (sstr_is_inline (&s) && (sstr_size (&s) == 5));
+
+    str_t *lng = str_new_c_copy ("a string too long to be stored inline", -1);
+    assert (sstr_set (&s, lng));
+    assert (!sstr_is_inline (&s) && (s.str.data == lng->data));
+    str_free (lng);
+
+    // Assign a part of ourselves
+    sstr_str (&s, &view);
+    view.size = 8;
+    assert (sstr_set (&s, &view));
+    str_done (&view);
+    assert (sstr_is_inline (&s));
+
+    sstr_str (&s, &view);
+    test_str (n, &view);
+    str_done (&view);
+    sstr_done (&s);
+}
+
+static void test_intern (int n)
+{
+    int i;
+    char temp [32];
+    const str_t *syms [1000];
+
+    // Force the symbol table to grow a few times
+    for (i = 0; i < ARRAY_LEN (syms); i++)
+    {
+        snprintf (temp, sizeof (temp), "symbol%d", i);
+        syms [i] = str_intern_c (temp, -1);
+        assert (syms [i]);
+    }
+
+    for (i = 0; i < ARRAY_LEN (syms); i++)
+    {
+        str_t key;
+        snprintf (temp, sizeof (temp), "symbol%d", i);
+        str_init_c_copy (&key, temp, -1);
+        assert (str_intern (&key) == syms [i]);
+        assert (str_cmp (&key, syms [i]) == 0);
+        str_done (&key);
+    }
+
+    assert (str_intern_c ("symbol1", -1) != str_intern_c ("symbol10", -1));
+
+    test_str (n, (str_t *)syms [42]);
+}
+
+static void test_builder (int n)
+{
+    int i;
+    str_builder_t sb;
+    str_builder_init (&sb);
+
+    // Join a few thousand paths
+    for (i = 0; i < 5000; i++)
+    {
+        char temp [40];
+        int size = snprintf (temp, sizeof (temp), "libs/module%d/file.c", i);
+        if (i)
+            assert (str_builder_append_char (&sb, ' '));
+        assert (str_builder_append_c (&sb, temp, size));
+    }
+
+    int size = str_builder_size (&sb);
+    str_t joined;
+    assert (str_builder_flatten (&sb, &joined));
+    assert (str_builder_size (&sb) == 0);
+    assert ((joined.size == size) && (joined.allocated == size + 1));
+
+    // Check the text is not damaged
+    int pos = 0, words = 0;
+    for (;;)
+    {
+        words++;
+        if (!str_find_char (&joined, &pos, ' '))
+            break;
+        pos++;
+    }
+    assert (words == 5000);
+
+    str_t tail;
+    str_init_c_const (&tail, joined.data + joined.size - 22, -1);
+    test_str (n, &tail);
+    str_done (&joined);
+}
+
+static void test_substr (int n)
+{
+    str_t *path = str_new_c_copy ("libs/useful/str.c", -1);
+    str_t dir, file;
+
+    // Slicing must not copy anything
+    long allocs = str_alloc_count ();
+    assert (str_init_substr (&dir, path, 0, 11));
+    assert (str_init_substr (&file, path, 12, 5));
+    assert (str_alloc_count () == allocs);
+    assert ((dir.data == path->data) && (file.data == path->data + 12));
+
+    // file ends where path ends, so it is already zero-terminated
+    assert (strcmp (str_c (&file), "str.c") == 0);
+    assert (str_alloc_count () == allocs);
+
+    // dir is not, so it gets a private copy
+    assert (strcmp (str_c (&dir), "libs/useful") == 0);
+    assert (dir.data != path->data);
+    assert (strcmp (str_c (path), "libs/useful/str.c") == 0);
+
+    // Modifying a substring must not touch the parent
+    str_t ext = STR_INIT_C ("h");
+    assert (str_replace (&file, 4, 1, &ext));
+    assert (strcmp (str_c (path), "libs/useful/str.c") == 0);
+
+    str_free (path);
+    test_str (n, &file);
+    str_done (&file);
+    str_done (&dir);
+}
+
+static void test_prealloc (int n)
+{
+    // A buffer which has no room for the terminator
+    char *data = malloc (5);
+    memcpy (data, "exact", 5);
+    str_t exact;
+    str_init_c_prealloc (&exact, data, 5);
+    assert (exact.allocated == exact.size);
+
+    assert (strcmp (str_c (&exact), "exact") == 0);
+    assert (exact.allocated > exact.size);
+
+    // A substring ending at the end of such a buffer
+    data = malloc (9);
+    memcpy (data, "two words", 9);
+    str_t words, tail;
+    str_init_c_prealloc (&words, data, 9);
+    assert (str_init_substr (&tail, &words, 4, 5));
+    str_done (&words);
+
+    assert (strcmp (str_c (&tail), "words") == 0);
+
+    test_str (n, &exact);
+    str_done (&tail);
+    str_done (&exact);
+}
+
+static void test_file (int n)
+{
+    str_t self, copy;
+
+    // Load our own source, which has to be mapped into memory
+    assert (str_init_file (&self, __FILE__));
+    assert ((self.size > 0) && (memcmp (self.data, "#include", 8) == 0));
+
+    // Sharing a file buffer is free, modifying it makes a copy
+    assert (str_init_copy (&copy, &self));
+    assert (copy.data == self.data);
+    str_t tail = STR_INIT_C ("\n// EOF\n");
+    assert (str_append (&copy, &tail));
+    assert ((copy.data != self.data) && (copy.size == self.size + tail.size));
+    assert (memcmp (copy.data, self.data, (size_t)self.size) == 0);
+
+    // Missing files must fail cleanly
+    str_t missing;
+    assert (!str_init_file (&missing, "tests/str/no-such-file"));
+    assert (missing.size == 0);
+
+    str_t head;
+    assert (str_init_substr (&head, &self, 0, 8));
+    str_done (&self);
+    test_str (n, &head);
+    str_done (&head);
+    str_done (&copy);
+}
+
+static void test_hash (int n)
+{
+    str_t *a = str_new_c_copy ("CFLAGS", -1);
+    str_t *b = str_new_c_copy ("CFLAGS", -1);
+    str_t c = STR_INIT_C ("LDFLAGS");
+
+    // Equal strings have equal hashes, which are cached
+    assert (str_hash (a) == str_hash (b));
+    assert ((a->hash != 0) && str_equal (a, b));
+    assert (str_hash (&c) != str_hash (a));
+    assert (!str_equal (a, &c));
+
+    // Interned strings come with a hash, and accept the cached one
+    const str_t *sym = str_intern (a);
+    assert (sym->hash == a->hash);
+    assert (str_equal (sym, b));
+
+    // Any modification drops the cached hash
+    str_t tail = STR_INIT_C ("_X");
+    assert (str_append (b, &tail));
+    assert ((b->hash == 0) && !str_equal (a, b));
+    assert (str_delete (b, 6, 2));
+    assert ((b->hash == 0) && str_equal (a, b));
+    assert (str_hash (b) == str_hash (a));
+
+    test_str (n, b);
+    str_free (a);
+    str_free (b);
+}
+
+static void test_charset (int n)
+{
+    int i, j;
+    char text [256];
+    charset_t stop, word, hex;
+
+    charset_init (&stop, " \t\r\n#,{}=$");
+    word = stop;
+    charset_invert (&word);
+    charset_init (&hex, "ABCDEFabcdef");
+    charset_add_range (&hex, '0', '9');
+
+    assert (charset_has (&stop, '{') && !charset_has (&stop, 'a'));
+    assert (charset_has (&word, 'a') && !charset_has (&word, '{'));
+    assert (charset_has (&word, '\0') && charset_has (&word, '\xff'));
+
+    // Every position, every length: fast scanners must agree with charset_has
+    for (i = 0; i < (int)sizeof (text); i++)
+        text [i] = (i % 37 == 36) ? " #{\n"[i % 4] : "ab0Fxyz_/.-"[i % 11];
+
+    for (i = 0; i < 64; i++)
+        for (j = i; j <= (int)sizeof (text); j += 7)
+        {
+            size_t size = (size_t)(j - i);
+            const charset_t *sets [] = { &stop, &word, &hex };
+            for (int k = 0; k < 3; k++)
+            {
+                size_t span = 0, find = 0;
+                while ((span < size) && charset_has (sets [k], text [i + span]))
+                    span++;
+                while ((find < size) && !charset_has (sets [k], text [i + find]))
+                    find++;
+                assert (mem_span (text + i, size, sets [k]) == span);
+                assert (mem_find_any (text + i, size, sets [k]) == find);
+            }
+        }
+
+    str_t s = STR_INIT_C ("libs/useful/str.c  ${CFLAGS}");
+    int word_end = str_find_any (&s, 0, &stop);
+    int next = str_span (&s, word_end, &word);
+    assert ((word_end == 17) && (next == 17));
+    next = str_find_any (&s, word_end, &word);
+    assert (next == 21);
+
+    // s is a constant, so take a real copy to be able to print it
+    str_t token;
+    assert (str_init_c_copy (&token, s.data, word_end));
+    test_str (n, &token);
+    str_done (&token);
+}
+
 int main ()
 {
     int i;
@@ -69,6 +374,16 @@ int main ()
     for (i = 0; i < 4; i++)
         str_done (&words [i]);
 
+    test_threads (11);
+    test_sstr (12);
+    test_intern (13);
+    test_builder (14);
+    test_substr (15);
+    test_file (16);
+    test_hash (17);
+    test_charset (18);
+    test_prealloc (19);
+
     str_finalize ();
 
     printf ("...\nN. profit!\n");
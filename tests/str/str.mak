@@ -1,5 +1,11 @@
-TESTS += tstr
+TESTS += tstr tbench-str
 DESCRIPTION.tstr = Проверка функций для работы со строками
 TARGETS.tstr = tstr$E
-SRC.tstr$E = $(wildcard tests/str/*.c)
+SRC.tstr$E = tests/str/main.c
 LIBS.tstr += useful$L
+LDFLAGS.tstr += -pthread
+
+DESCRIPTION.tbench-str = Измерение скорости работы со строками
+TARGETS.tbench-str = tbench-str$E
+SRC.tbench-str$E = tests/str/bench.c
+LIBS.tbench-str += useful$L
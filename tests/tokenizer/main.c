@@ -5,35 +5,6 @@
 
 #define TEST_RCP "tests/tokenizer/test.rcp"
 
-bool load (const char *fn, str_t *str)
-{
-    FILE *inf = fopen (fn, "r");
-    if (!inf)
-        return false;
-
-    fseek (inf, 0, SEEK_END);
-    off_t fsize = ftell (inf);
-    fseek (inf, 0, SEEK_SET);
-
-    if (fsize < 0)
-    {
-        fclose (inf);
-        return false;
-    }
-
-    size_t msize = (size_t)fsize;
-    char *buf = malloc (msize);
-    if (fread (buf, 1, msize, inf) != msize)
-    {
-        fclose (inf);
-        return false;
-    }
-
-    str_init_c_prealloc (str, buf, (int)msize);
-    fclose (inf);
-    return true;
-}
-
 int main (int argc, const char **argv)
 {
     const char *fn;
@@ -46,7 +17,7 @@ int main (int argc, const char **argv)
     else
         fn = argv [1];
 
-    if (!load (fn, &in.text))
+    if (!input_set_file (&in, fn))
     {
         fprintf (stderr, "Failed to load input file '%s'\n", fn);
         return -1;
@@ -57,10 +28,27 @@ int main (int argc, const char **argv)
     {
         // make a copy since we want it zero-terminated
         str_expand (&tok.text, 0);
-        printf ("%d:%d token %d(%s) [%s]:%d\n",
-                tok.line + 1, tok.column + 1,
+        int line, column;
+        input_pos (&in, tok.ofs, &line, &column);
+        printf ("%d:%d token %d(%s) [%s]:%d",
+                line + 1, column + 1,
                 tok.code, token_name (tok.code),
                 str_c (&tok.text), tok.text.size);
+
+        // Words with quotes and escapes come as written
+        if (tok.escaped)
+        {
+            str_t value;
+            if (token_unescape (&tok, &value))
+            {
+                printf (" = [%s]:%d", str_c (&value), value.size);
+                str_done (&value);
+            }
+            else
+                printf (" = invalid");
+        }
+
+        printf ("\n");
         fflush (stdout);
 
         str_done (&tok.text);
@@ -0,0 +1,289 @@
+#include "tokenizer.h"
+#include "rand.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+static const char *recipes [] =
+{
+    "tests/tokenizer/test.rcp",
+    "tests/tokenizer/zzz.rcp",
+};
+
+static const int chunks [] = { 1, 2, 3, 5, 8, 13, 64, 0 };
+
+// Put the text into a temporary file, return its descriptor
+static FILE *temp_file (const str_t *text)
+{
+    FILE *f = tmpfile ();
+    assert (f);
+    assert (fwrite (text->data, 1, (size_t)text->size, f) == (size_t)text->size);
+    assert (fflush (f) == 0);
+    return f;
+}
+
+/* Tokenize the text from memory and from a file with given chunk size,
+ * the tokens and their positions must be the same. Returns the number
+ * of tokens, max_window receives the largest window size.
+ */
+static int compare (str_t *text, int chunk, int *max_window)
+{
+    str_t name = STR_INIT_C ("test");
+    FILE *f = temp_file (text);
+    assert (lseek (fileno (f), 0, SEEK_SET) == 0);
+
+    input_t mem, stream;
+    input_init (&mem);
+    input_init (&stream);
+    input_set_text (&mem, text, &name);
+    assert (input_set_fd (&stream, fileno (f), &name, chunk));
+
+    int count = 0;
+    *max_window = 0;
+    token_t mtok, stok;
+    while (input_token (&mem, &mtok))
+    {
+        assert (input_token (&stream, &stok));
+        assert (stok.code == mtok.code);
+        assert (stok.ofs == mtok.ofs);
+        assert (stok.text.size == mtok.text.size);
+        assert (memcmp (stok.text.data, mtok.text.data, (size_t)mtok.text.size) == 0);
+        assert (stok.escaped == mtok.escaped);
+
+        int mline, mcol, sline, scol;
+        assert (input_pos (&mem, mtok.ofs, &mline, &mcol));
+        assert (input_pos (&stream, stok.ofs, &sline, &scol));
+        assert ((sline == mline) && (scol == mcol));
+
+        if (*max_window < stream.text.allocated)
+            *max_window = stream.text.allocated;
+
+        token_done (&mtok);
+        token_done (&stok);
+        count++;
+    }
+
+    assert (!input_token (&stream, &stok));
+    assert (!stream.read_error);
+
+    input_done (&mem);
+    input_done (&stream);
+    fclose (f);
+    return count;
+}
+
+// Every token of the recipes straddles chunk boundaries with some chunk size
+static void test_recipes (int n)
+{
+    for (unsigned i = 0; i < ARRAY_LEN (recipes); i++)
+    {
+        str_t text;
+        assert (str_init_file (&text, recipes [i]));
+
+        int count = 0, window;
+        for (unsigned j = 0; j < ARRAY_LEN (chunks); j++)
+            count = compare (&text, chunks [j], &window);
+
+        printf ("%d. %s: %d tokens\n", n, recipes [i], count);
+        str_done (&text);
+    }
+}
+
+// A large file is read through a small window
+static void test_large (int n)
+{
+    str_t part, text;
+    assert (str_init_file (&part, recipes [0]));
+    str_init (&text);
+    for (int i = 0; i < 2000; i++)
+        assert (str_append (&text, &part) && str_append_c_const (&text, "\n", 1));
+
+    int window;
+    int count = compare (&text, 4096, &window);
+    printf ("%d. %d bytes, %d tokens, window %s\n", n, text.size, count,
+            (window < 3 * 4096) ? "small" : "large");
+    assert (window < 3 * 4096);
+
+    str_done (&text);
+    str_done (&part);
+}
+
+// A token much longer than a chunk makes the window grow
+static void test_long_token (int n)
+{
+    str_t text;
+    str_init (&text);
+    assert (str_append_c_const (&text, "A = \"", -1));
+    for (int i = 0; i < 20000; i++)
+        assert (str_append_c_const (&text, "multi-line \"\" string\n", -1));
+    assert (str_append_c_const (&text, "\" \\u1234;\\x1F600;\nB = ${C}\n", -1));
+
+    int window;
+    int count = compare (&text, 100, &window);
+    printf ("%d. %d tokens, window %s\n", n, count,
+            (window > text.size - 100) ? "fits the token" : "too small");
+    assert (window > text.size - 100);
+
+    str_done (&text);
+}
+
+// Random text, including broken escapes and quotes
+static void test_random (int n, int count)
+{
+    static const char *pieces [] =
+    {
+        " ", "\t", "\n", "\r\n", "word", "\"", "\"\"", "\\", "\\n", "\\u", "\\x",
+        "12", "f;", ";", "=", "+", "-", "?", "$", "{", "}", ",", "#"
+    };
+
+    rand_state_t rs;
+    rand_init (&rs, n);
+
+    int tokens = 0;
+    for (int i = 0; i < count; i++)
+    {
+        str_t text;
+        str_init (&text);
+        for (int j = rand_range (&rs, 60); j >= 0; j--)
+            assert (str_append_c_const (&text, pieces [rand_range (&rs, ARRAY_LEN (pieces))], -1));
+
+        int window;
+        tokens += compare (&text, 1 + (int)rand_range (&rs, 7), &window);
+        str_done (&text);
+    }
+
+    printf ("%d. %d random texts, %d tokens\n", n, count, tokens);
+}
+
+// Write a list of unique file names to a temporary file
+static FILE *file_list (int lines)
+{
+    FILE *f = tmpfile ();
+    assert (f);
+    for (int i = 0; i < lines; i++)
+        assert (fprintf (f, "src/module%d/file%07d.c\n", i % 100, i) > 0);
+    assert (fflush (f) == 0);
+    return f;
+}
+
+// Tokenize a file in a child process, return its peak memory use in KB
+static long stream_peak (FILE *f, int *tokens)
+{
+    int fds [2];
+    assert (pipe (fds) == 0);
+
+    pid_t pid = fork ();
+    assert (pid >= 0);
+    if (pid == 0)
+    {
+        str_t name = STR_INIT_C ("list");
+        input_t in;
+        input_init (&in);
+        assert (lseek (fileno (f), 0, SEEK_SET) == 0);
+        assert (input_set_fd (&in, fileno (f), &name, 0));
+
+        int count = 0;
+        token_t tok;
+        while (input_token (&in, &tok))
+        {
+            count++;
+            token_done (&tok);
+        }
+
+        assert (!in.read_error);
+        assert (write (fds [1], &count, sizeof (count)) == sizeof (count));
+        _exit (0);
+    }
+
+    int status;
+    struct rusage ru;
+    assert (wait4 (pid, &status, 0, &ru) == pid);
+    assert (WIFEXITED (status) && (WEXITSTATUS (status) == 0));
+    assert (read (fds [0], tokens, sizeof (*tokens)) == sizeof (*tokens));
+    close (fds [0]);
+    close (fds [1]);
+
+    return ru.ru_maxrss;
+}
+
+// Memory used by a stream must not depend on the file size
+static void test_memory (int n)
+{
+    static const int lines [] = { 20000, 640000 };
+    long peak [ARRAY_LEN (lines)];
+
+    for (unsigned i = 0; i < ARRAY_LEN (lines); i++)
+    {
+        FILE *f = file_list (lines [i]);
+        int tokens;
+        peak [i] = stream_peak (f, &tokens);
+        assert (tokens == lines [i] * 2);
+        fclose (f);
+    }
+
+    long growth = peak [1] - peak [0];
+    printf ("%d. %d times larger file, memory use %s\n", n,
+            lines [1] / lines [0], (growth < 1024) ? "same" : "grows");
+    assert (growth < 1024);
+}
+
+// Words and spaces of any length, short ones and ones scanned with SIMD
+static void test_runs (int n)
+{
+    str_t text;
+    str_init (&text);
+    for (int len = 1; len <= 100; len++)
+    {
+        for (int i = 0; i < len; i++)
+            assert (str_append_c_const (&text, (i & 1) ? "b" : "a", 1));
+        for (int i = 0; i < len; i++)
+            assert (str_append_c_const (&text, " ", 1));
+        assert (str_append_c_const (&text, "=", 1));
+    }
+
+    str_t name = STR_INIT_C ("test");
+    input_t input;
+    input_init (&input);
+    input_set_text (&input, &text, &name);
+
+    token_t token;
+    for (int len = 1; len <= 100; len++)
+    {
+        assert (input_token (&input, &token) && (token.code == TOK_WORD));
+        assert (token.text.size == len);
+        token_done (&token);
+        assert (input_token (&input, &token) && (token.code == TOK_SPACE));
+        assert (token.text.size == len);
+        token_done (&token);
+        assert (input_token (&input, &token) && (token.code == TOK_ASSIGN));
+        token_done (&token);
+    }
+    assert (!input_token (&input, &token));
+    input_done (&input);
+
+    int window;
+    int count = compare (&text, 7, &window);
+    printf ("%d. runs of 1 to 100 characters, %d tokens\n", n, count);
+
+    str_done (&text);
+}
+
+int main ()
+{
+    test_recipes (1);
+    test_large (2);
+    test_long_token (3);
+    test_random (4, 2000);
+    test_memory (5);
+    test_runs (6);
+
+    str_finalize ();
+    printf ("\nDone!\n");
+
+    return 0;
+}
@@ -1,5 +1,12 @@
-TESTS += ttokenizer
+TESTS += ttokenizer tstream-tokenizer
 DESCRIPTION.ttokenizer = Проверка токенизатора
 TARGETS.ttokenizer = ttokenizer$E
-SRC.ttokenizer$E = $(wildcard tests/tokenizer/*.c)
+SRC.ttokenizer$E = tests/tokenizer/main.c
 LIBS.ttokenizer += cooker$L useful$L
+LDFLAGS.ttokenizer += -pthread
+
+DESCRIPTION.tstream-tokenizer = Проверка потокового токенизатора
+TARGETS.tstream-tokenizer = tstream-tokenizer$E
+SRC.tstream-tokenizer$E = tests/tokenizer/stream.c
+LIBS.tstream-tokenizer += cooker$L useful$L
+LDFLAGS.tstream-tokenizer += -pthread
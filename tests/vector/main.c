@@ -1,4 +1,5 @@
 #include "strvec.h"
+#include "tvector.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -52,6 +53,272 @@ static void test_vector (int n, vector_t *vec)
     str_done (&s);
 }
 
+static void test_sorted (vector_t *vec, bool stable)
+{
+    for (int i = 1; i < vec->size; i++)
+    {
+        int cmp = vec->vmt->compare (vec->data [i - 1], vec->data [i]);
+        assert (cmp <= 0);
+        // Items with equal keys are allocated in order
+        if (stable && (cmp == 0))
+            assert (vec->data [i - 1] < vec->data [i]);
+    }
+}
+
+// Elements compared by key only, to check sort stability
+typedef struct
+{
+    int key;
+    int seq;
+} pair_t;
+
+static int pair_compare (const void *item1, const void *item2)
+{
+    const pair_t *p1 = item1, *p2 = item2;
+    return (p1->key > p2->key) - (p1->key < p2->key);
+}
+
+static const vector_vmt_t pair_vmt = { free, pair_compare, NULL, NULL };
+
+// A string vector without the radix sort
+static const vector_vmt_t generic_str_vmt =
+{
+    NULL, (int (*) (const void *, const void *))str_cmp, NULL, NULL
+};
+
+static void test_sort (int n)
+{
+    const int size = 5000;
+    int pattern, i;
+
+    // random, sorted, reversed, few distinct keys, organ pipe
+    for (pattern = 0; pattern < 5; pattern++)
+    {
+        vector_t v1, v2;
+        vector_init (&v1, size);
+        vector_init (&v2, size);
+        v1.vmt = v2.vmt = &pair_vmt;
+
+        pair_t *pairs = calloc ((size_t)size * 2, sizeof (pair_t));
+        for (i = 0; i < size; i++)
+        {
+            int key;
+            switch (pattern)
+            {
+                case 0:  key = rand (); break;
+                case 1:  key = i; break;
+                case 2:  key = size - i; break;
+                case 3:  key = rand () & 7; break;
+                default: key = (i < size / 2) ? i : size - i; break;
+            }
+            pairs [i].key = pairs [size + i].key = key;
+            pairs [i].seq = pairs [size + i].seq = i;
+            vector_append (&v1, &pairs [i]);
+            vector_append (&v2, &pairs [size + i]);
+        }
+
+        assert (vector_sort (&v1));
+        test_sorted (&v1, false);
+        assert (vector_sort_stable (&v2));
+        for (i = 1; i < size; i++)
+        {
+            const pair_t *p1 = v2.data [i - 1], *p2 = v2.data [i];
+            assert ((p1->key < p2->key) || ((p1->key == p2->key) && (p1->seq < p2->seq)));
+        }
+
+        // Don't free the pairs one by one
+        v1.vmt = v2.vmt = NULL;
+        vector_done (&v1);
+        vector_done (&v2);
+        free (pairs);
+    }
+
+    // Radix sort must give same order as str_cmp
+    vector_t *v3 = vector_str_new (size);
+    vector_t v4;
+    vector_init (&v4, size);
+    v4.vmt = &generic_str_vmt;
+    for (i = 0; i < size; i++)
+    {
+        char temp [64];
+        int len = snprintf (temp, sizeof (temp), "libs/%s/%x%s",
+            (i & 1) ? "useful" : "cooker", rand () & 0xfff, (i & 2) ? ".c" : "");
+        str_t *str = str_new_c_copy (temp, len);
+        vector_append (v3, str);
+        vector_append (&v4, str);
+    }
+    vector_append (v3, NULL);
+    vector_append (&v4, NULL);
+
+    assert (vector_sort_stable (v3));
+    test_sorted (v3, false);
+    assert (vector_sort (&v4));
+    for (i = 0; i < v3->size; i++)
+        assert (str_cmp (v3->data [i], v4.data [i]) == 0);
+
+    vector_done (&v4);
+    vector_free (v3);
+
+    /* Keys nested in each other ("a", "ab", "aa", "aab"...) must not
+     * recurse once per byte. They all are substrings of "aa...ab".
+     */
+    const int nested = 8000;
+    char *text = malloc ((size_t)nested + 2);
+    memset (text, 'a', (size_t)nested);
+    strcpy (text + nested, "b");
+    str_t *parent = str_new_c_prealloc (text, -1);
+
+    v3 = vector_str_new (2 * nested);
+    vector_init (&v4, 2 * nested);
+    v4.vmt = &generic_str_vmt;
+    for (i = 0; i < 2 * nested; i++)
+    {
+        int len = nested - i / 2;
+        int end = nested + (i & 1);
+        str_t *str = malloc (sizeof (str_t));
+        assert (str_init_substr (str, parent, end - len, len));
+        vector_append (v3, str);
+        vector_append (&v4, str);
+    }
+    str_free (parent);
+
+    assert (vector_sort (v3));
+    test_sorted (v3, false);
+    assert (vector_sort (&v4));
+    for (i = 0; i < v3->size; i++)
+        assert (str_cmp (v3->data [i], v4.data [i]) == 0);
+
+    vector_done (&v4);
+    vector_free (v3);
+
+    printf ("%d. [ok]\n", n);
+}
+
+static str_t *make_str (const char *text)
+{
+    return str_new_c_copy (text, -1);
+}
+
+static void test_bulk (int n)
+{
+    int i;
+    vector_t vec, batch;
+    vector_str_init (&vec, 0);
+    vector_init (&batch, 0);
+
+    // Start with every even number
+    for (i = 0; i < 1000; i += 2)
+    {
+        char temp [16];
+        snprintf (temp, sizeof (temp), "%04d", i);
+        assert (vector_append (&batch, make_str (temp)));
+    }
+    assert (vector_insert_sorted_bulk (&vec, &batch, VECTOR_DUP_REJECT));
+    assert ((vec.size == 500) && (batch.size == 0));
+    test_sorted (&vec, false);
+
+    // Odd numbers in reverse order, plus a duplicate
+    for (i = 999; i > 0; i -= 2)
+    {
+        char temp [16];
+        snprintf (temp, sizeof (temp), "%04d", i);
+        assert (vector_append (&batch, make_str (temp)));
+    }
+    str_t *dup = make_str ("0500");
+    assert (vector_append (&batch, dup));
+
+    // Rejecting leaves everything in place
+    assert (!vector_insert_sorted_bulk (&vec, &batch, VECTOR_DUP_REJECT));
+    assert ((vec.size == 500) && (batch.size == 501));
+
+    // Keeping the old element frees the new one
+    str_t *old = vec.data [250];
+    assert (vector_insert_sorted_bulk (&vec, &batch, VECTOR_DUP_KEEP));
+    assert ((vec.size == 1000) && (batch.size == 0));
+    assert (vec.data [500] == old);
+    test_sorted (&vec, false);
+
+    // Replacing: the last duplicate in the batch wins
+    str_t *first = make_str ("0042"), *second = make_str ("0042");
+    assert (vector_append (&batch, first));
+    assert (vector_append (&batch, make_str ("zzz")));
+    assert (vector_append (&batch, second));
+    assert (vector_insert_sorted_bulk (&vec, &batch, VECTOR_DUP_REPLACE));
+    assert ((vec.size == 1001) && (vec.data [42] == second));
+    test_sorted (&vec, false);
+
+    test_vector (n, &vec);
+
+    vector_done (&batch);
+    vector_done (&vec);
+}
+
+// A vector of structures stored by value
+typedef struct
+{
+    int key;
+    char name [12];
+} point_t;
+
+VECTOR_DEFINE (vector_point, point_t)
+
+static int point_compare_key (const point_t *item, const void *key)
+{
+    const point_t *p = key;
+    return (item->key > p->key) - (item->key < p->key);
+}
+
+static void test_typed (int n)
+{
+    int i;
+    vector_point_t vec;
+    vector_point_init (&vec);
+
+    // Insert in some pseudo-random order
+    for (i = 0; i < 100; i++)
+    {
+        point_t p;
+        p.key = (i * 37) % 100;
+        snprintf (p.name, sizeof (p.name), "p%d", p.key);
+        assert (vector_point_insert_sorted (&vec, &p, point_compare_key) >= 0);
+    }
+    assert (vec.size == 100);
+    for (i = 0; i < vec.size; i++)
+        assert (vec.data [i].key == i);
+
+    point_t key = { 42, "" };
+    int pos = vector_point_find_sorted (&vec, &key, point_compare_key);
+    assert ((pos == 42) && (strcmp (vec.data [pos].name, "p42") == 0));
+
+    // Delete everything but the last ten elements
+    assert (vector_point_delete (&vec, 0, 90));
+    assert ((vec.size == 10) && (vec.data [0].key == 90));
+    assert (vector_point_find_sorted (&vec, &key, point_compare_key) == -1);
+    assert (!vector_point_delete (&vec, 5, 6));
+
+    point_t last;
+    assert (vector_point_pop (&vec, &last) && (last.key == 99));
+    assert (vector_point_get (&vec, 9) == NULL);
+
+    printf ("%d.", n);
+    for (i = 0; i < vec.size; i++)
+        printf (" [%s]", vec.data [i].name);
+    printf ("\n");
+
+    // Copy elements of the vector into itself while it grows
+    for (i = 0; i < 1000; i++)
+    {
+        assert (vector_point_append (&vec, &vec.data [0]));
+        assert (vector_point_insert (&vec, 0, &vec.data [vec.size - 1]));
+    }
+    int copies = 0;
+    for (i = 0; i < vec.size; i++)
+        copies += (vec.data [i].key == 90) && (strcmp (vec.data [i].name, "p90") == 0);
+    assert ((vec.size == 2009) && (copies == 2001));
+
+    vector_point_done (&vec);
+}
+
 int main ()
 {
     int i, j;
@@ -93,6 +360,7 @@ int main ()
     }
 
     assert (vector_qsort (v2));
+    test_sorted (v2, false);
     test_vector (3, v2);
 
     for (i = 1; i < 675; i++)
@@ -111,6 +379,10 @@ int main ()
     vector_free (v2);
     vector_done (&v1);
 
+    test_sort (5);
+    test_bulk (6);
+    test_typed (7);
+
     str_finalize ();
 
     printf ("...\nN. profit!\n");